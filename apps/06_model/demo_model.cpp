@@ -2,6 +2,7 @@
 
 #include <renderer.h>
 #include <math/matrix4.h>
+#include <math/packet.h>
 
 #include <gl_window.h>
 
@@ -9,6 +10,7 @@
 #include <sampler.h>
 #include <model.h>
 #include <objload.h>
+#include <meshopt.h>
 
 
 struct Vertex
@@ -53,21 +55,29 @@ int main(int argc, char** argv)
     Renderer rasterizer(1280, 720);
 
     /*========== Setup Shader Program ========*/
-    Program<Vertex, Varying, Uniforms> program;
-    program.onVertex([](const Uniforms& uniform, const Vertex& in, Varying& out)
-    {
-        out.position = uniform.proj * uniform.view * uniform.model * Vec4(in.position, 1.0f);
-        out.uv = in.texcoord;
-    });
-
-    program.onFragment([](const Uniforms& uniform, const Varying& in, Vec4& out)
-    {
-        out = texture(uniform.material.diffuse, in.uv) / 255.0f;
-    });
+    /* statically dispatched shaders (inlined into the rasterizer), the vertex shader transforms packets of vertices */
+    auto program = make_program<Vertex, Varying, Uniforms>(
+        batch_shader([](const Uniforms& uniform, std::span<const Vertex> in, std::span<Varying> out)
+        {
+            const Mat4 mvp = uniform.proj * uniform.view * uniform.model;
+            for(std::size_t i = 0; i < in.size(); i += packet_size)
+            {
+                store(mvp * Vec4Packet<>(load(in.subspan(i), &Vertex::position), 1.0f), out.subspan(i), &Varying::position);
+            }
+
+            for(std::size_t i = 0; i < in.size(); i++) out[i].uv = in[i].texcoord;
+        }),
+        [](const Uniforms& uniform, const Varying& in, Vec4& out)
+        {
+            out = texture(uniform.material.diffuse, in.uv) / 255.0f;
+        });
 
     /* model */
     auto model = asset::loadObj<Mesh>("assets/sad_toaster/sad_toaster.obj");
     auto& mesh = model.meshes().front();
+
+    asset::optimizeMesh(mesh);
+
     BufferIndexed<Vertex, unsigned int> buffer;
     buffer.vertices = mesh.vertices();
     buffer.indices = mesh.materialGroups().front().indices;
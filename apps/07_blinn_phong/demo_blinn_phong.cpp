@@ -2,6 +2,7 @@
 
 #include <renderer.h>
 #include <math/matrix4.h>
+#include <math/packet.h>
 
 #include <gl_window.h>
 
@@ -60,12 +61,13 @@ struct Uniforms
     Light light;
 };
 
-Vec3 blinn_phong(const Vec3& lightDir, const Vec3& viewDir, const Vec3& normal, const Vec3& diffuse, const Vec3& specular, float shininess)
+/* lane-wise for a packet of fragments */
+Vec3Packet<> blinn_phong(const Vec3Packet<>& lightDir, const Vec3Packet<>& viewDir, const Vec3Packet<>& normal, const Vec3& diffuse, const Vec3& specular, float shininess)
 {
     auto halfwayDir = normalize(lightDir + viewDir);
 
-    float diff = std::max<float>(dot(normal, lightDir), 0.0);
-    float spec = std::pow(std::max<float>(dot(normal, halfwayDir), 0.0), shininess);
+    Packet<> diff = max(dot(normal, lightDir), Packet<>(0.0f));
+    Packet<> spec = pow(max(dot(normal, halfwayDir), Packet<>(0.0f)), shininess);
 
     return (diff * diffuse) + (spec * specular);
 }
@@ -75,28 +77,32 @@ int main(int argc, char** argv)
     Renderer rasterizer(1280, 720);
 
     /*========== Setup Shader Program ========*/
-    Program<Vertex, Varying, Uniforms> program;
-    program.onVertex([](const Uniforms& uniform, const Vertex& in, Varying& out)
+    auto vertex_shader = [](const Uniforms& uniform, const Vertex& in, Varying& out)
     {
         auto word_pos = uniform.model * Vec4(in.position, 1.0f);
         out.position = uniform.proj * uniform.view * word_pos;
         out.world_position = Vec3(word_pos);
         out.normal = Mat3(uniform.model) * in.normal;
         out.uv = in.texcoord;
-    });
+    };
 
-    program.onFragment([](const Uniforms& uniform, const Varying& in, Vec4& out)
+    /* shades packets of 4x2 fragments at once */
+    auto fragment_shader = [](const Uniforms& uniform, const FragmentPacket<Varying>& in, unsigned int, Vec4Packet<>& out)
     {
-        auto normal = normalize(in.normal);
-        auto viewDir = normalize(uniform.viewPos - in.world_position);
-        auto lightDir = normalize(uniform.light.position - in.world_position);
+        Vec3Packet<> world_position = load(in, &Varying::world_position);
 
-        Vec3 illuminance = uniform.light.ambient * uniform.material.ambient * uniform.material.diffuse;
-        illuminance += uniform.light.color
-                * blinn_phong(lightDir, viewDir, normal, uniform.material.diffuse, uniform.material.specular, uniform.material.shininess);
+        auto normal = normalize(load(in, &Varying::normal));
+        auto viewDir = normalize(uniform.viewPos - world_position);
+        auto lightDir = normalize(uniform.light.position - world_position);
 
-        out = Vec4(illuminance, 1.0);
-    });
+        Vec3 ambient = uniform.light.ambient * uniform.material.ambient * uniform.material.diffuse;
+        Vec3Packet<> illuminance = uniform.light.color
+                * blinn_phong(lightDir, viewDir, normal, uniform.material.diffuse, uniform.material.specular, uniform.material.shininess) + ambient;
+
+        out = Vec4Packet<>(illuminance, 1.0f);
+    };
+
+    auto program = make_program<Vertex, Varying, Uniforms>(vertex_shader, packet_shader(fragment_shader));
 
     /* load model */
     auto model = asset::loadObj<Mesh>("assets/sphere/sphere.obj");
@@ -94,8 +94,7 @@ int main(int argc, char** argv)
     Renderer rasterizer(1280, 720);
 
     /*========== Setup Shader Program ========*/
-    Program<Vertex, Varying, Uniforms> program;
-    program.onVertex([](const Uniforms& uniform, const Vertex& in, Varying& out)
+    auto vertex_shader = [](const Uniforms& uniform, const Vertex& in, Varying& out)
     {
         auto word_pos = uniform.model * Vec4(in.position, 1.0f);
         out.world_position = Vec3(word_pos);
@@ -114,31 +113,40 @@ int main(int argc, char** argv)
             out.view_tangent = normalize(Vec3(dot(tangent, v), dot(bitangent, v), dot(in.normal, v)));
             out.light_tangent = normalize(Vec3(dot(tangent, l), dot(bitangent, l), dot(in.normal, l)));
         }
-    });
+    };
 
-    program.onFragment([](const Uniforms& uniform, const Varying& in, Vec4& out)
+    /* varyings are interpolated when loaded: with bump mapping normal and world position are never interpolated, without it the tangent space vectors */
+    auto fragment_shader = [](const Uniforms& uniform, const LazyFragment<Varying>& in, Vec4& out)
     {
-        auto normal = normalize(in.normal);
-        auto viewDir = normalize(uniform.viewPos - in.world_position);
-        auto lightDir = normalize(uniform.light.position - in.world_position);
+        Vec3 normal, viewDir, lightDir;
+        Vec2 uv = load(in, &Varying::uv);
 
         if(uniform.use_bump_mapping)
         {
             /* retrieve normal vector and compute blinn phong in tangent space */
-            normal = normalize( Vec3(texture(uniform.material.map_bump, in.uv) / 255.0f) * 2.0 - Vec3(1.0, 1.0, 1.0) );
-            lightDir = in.light_tangent;
-            viewDir = in.view_tangent;
+            normal = normalize( Vec3(texture(uniform.material.map_bump, uv) / 255.0f) * 2.0 - Vec3(1.0, 1.0, 1.0) );
+            lightDir = load(in, &Varying::light_tangent);
+            viewDir = load(in, &Varying::view_tangent);
+        }
+        else
+        {
+            Vec3 world_position = load(in, &Varying::world_position);
+            normal = normalize(load(in, &Varying::normal));
+            viewDir = normalize(uniform.viewPos - world_position);
+            lightDir = normalize(uniform.light.position - world_position);
         }
 
         Vec3 illuminance = uniform.light.ambient * uniform.material.ambient * uniform.material.diffuse;
         illuminance += uniform.light.color
                 * blinn_phong(lightDir, viewDir, normal,
-                              texture(uniform.material.map_diffuse, in.uv) / 255.0f,
+                              texture(uniform.material.map_diffuse, uv) / 255.0f,
                               uniform.material.specular,
                               uniform.material.shininess);
 
         out = Vec4(illuminance, 1.0);
-    });
+    };
+
+    auto program = make_program<Vertex, Varying, Uniforms>(vertex_shader, lazy_shader(fragment_shader));
 
 
     /* load model */
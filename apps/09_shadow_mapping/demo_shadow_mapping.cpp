@@ -1,6 +1,7 @@
 #include <cstdlib>
 
 #include <renderer.h>
+#include <command_buffer.h>
 #include <math/matrix4.h>
 
 #include <gl_window.h>
@@ -85,16 +86,13 @@ int main(int argc, char** argv)
                                       true, false };
 
     /*========== Setup Shader Program (1. render pass - shadow mapp) ========*/
-    Program<Vertex, Varying, Uniforms, Framebuffer<Depth>> program_shadow;
-    program_shadow.onVertex([](const auto& uniform, const auto& in, auto& out)
+    auto vertex_shader_shadow = [](const Uniforms& uniform, const Vertex& in, Varying& out)
     {
         out.position = uniform.lightSpace * uniform.model * Vec4(in.position, 1.0f);
-    });
-
-    program_shadow.onFragment([](const auto& uniform, const auto& in, auto& out)
-    {
+    };
 
-    });
+    /* no fragment shader: only coverage and depth of the fragments are computed */
+    auto program_shadow = make_program<Vertex, Varying, Uniforms, Framebuffer<Depth>>(vertex_shader_shadow, depth_only);
 
 
     /*========== Setup Shader Program (2. render pass - lighting) ========*/
@@ -149,6 +147,7 @@ int main(int argc, char** argv)
         auto& buffer = buffers.emplace_back();
         buffer.vertices = mesh.vertices();
         buffer.indices = mesh.materialGroups().front().indices;
+        buffer.bounds = mesh.bounds();
 
         auto& material = materials.emplace_back();
         material = mesh.material(0);
@@ -174,29 +173,35 @@ int main(int argc, char** argv)
     /*========== OpenGL/GLFW Viewer ========*/
     Window window("Software-Rasterizer Shadow Mapping", 1280, 720);
 
+    /* both render passes are recorded each frame and submitted at once */
+    CommandBuffer commands;
+
     window.onDraw([&](Window& window, float dt)
     {
-        rasterizer.framebuffer().clear(Vec4(0, 0, 0, 1));
-        framebuffer_shadow.clear();
-
         uniforms_light.light.direction = Mat3::rotationY(-radians(dt*10.0f)) * uniforms_light.light.direction;
         uniforms_light.lightSpace = Mat4::ortho(-2.5, -2.5, 2.5, 2.5, 0, 10) * Mat4::lookAt(uniforms_light.light.direction * -3.0f, Vec3{0.5, 0, 0.5});
         uniforms_shadow.lightSpace = uniforms_light.lightSpace;
 
-        TIME_MS(
-        /* first render pass to create shadow map */
+        commands.reset();
+        commands.clear(Vec4(0, 0, 0, 1));
+
+        /* first render pass to create shadow map (meshes outside of the light frustum are culled) */
+        commands.bind(framebuffer_shadow, options_shadow);
+        commands.clear();
         for(unsigned int i = 0; i < buffers.size(); i++)
         {
-            rasterizer.draw(program_shadow, buffers[i], framebuffer_shadow, options_shadow);
+            commands.draw(uniforms_shadow.lightSpace * uniforms_shadow.model, program_shadow, buffers[i]);
         }
 
         /* second render pass to determine light contribution */
+        commands.bind_default();
         for(unsigned int i = 0; i < buffers.size(); i++)
         {
-            uniforms_light.material = materials[i];
-            rasterizer.draw(program_light, buffers[i]);
+            commands.execute([&, i]{ uniforms_light.material = materials[i]; });
+            commands.draw(uniforms_light.proj * uniforms_light.view * uniforms_light.model, program_light, buffers[i]);
         }
-        );
+
+        TIME_MS(rasterizer.submit(commands));
 
         window.swap(rasterizer.framebuffer());
     });
@@ -2,6 +2,7 @@
 
 #include <renderer.h>
 #include <math/matrix4.h>
+#include <math/packet.h>
 
 #include <gl_window.h>
 
@@ -9,6 +10,7 @@
 #include <sampler.h>
 #include <model.h>
 #include <objload.h>
+#include <meshopt.h>
 
 #include <random>
 
@@ -61,22 +63,45 @@ struct Uniforms
     Sampler<RGBAF> brdf;
 };
 
+/* lane-wise equirectangularUV */
+Vec2Packet<> equirectangularUV(const Vec3Packet<>& dir)
+{
+    Vec2Packet<> uv;
+    for(std::size_t i = 0; i < packet_size; i++)
+    {
+        Vec2 lane = equirectangularUV(Vec3(dir.x[i], dir.y[i], dir.z[i]));
+        uv.x[i] = lane.x; uv.y[i] = lane.y;
+    }
+    return uv;
+}
+
 int main(int argc, char** argv)
 {
     /* model */
     auto model = asset::loadObj<Mesh>("assets/camera/camera.obj");
     //auto model = asset::loadObj<Mesh>("assets/drakefire/drakefire.obj");
-    std::vector< BufferIndexed<Vertex, unsigned int> > buffers;
+    std::vector< BufferMeshlets<Vertex, unsigned int> > buffers;
     std::vector< Material > materials;
 
     for(auto& mesh : model.meshes())
     {
-        auto& buffer = buffers.emplace_back();
+        asset::optimizeMesh(mesh);
+
+        BufferIndexed<Vertex, unsigned int> buffer;
         buffer.vertices = mesh.vertices();
         buffer.indices = mesh.materialGroups().front().indices;
+        buffer.bounds = mesh.bounds();
+
+        /* meshlets outside of the view or facing away are culled before the vertex stage */
+        buffers.push_back(build_meshlets(buffer));
 
         auto& material = materials.emplace_back();
         material = mesh.material(0);
+
+        /* texture() selects the mip level from the uv derivatives of each pixel */
+        material.map_albedo.generate_mipmaps();
+        material.map_metallic_roughness.generate_mipmaps();
+        material.map_normal.generate_mipmaps();
     }
 
     /* load precomputed irradiance, radiance and brdf maps (see pbr_precompute.cpp) */
@@ -89,8 +114,7 @@ int main(int argc, char** argv)
 
 
     /*========== Setup Shader Program ========*/
-    Program<Vertex, Varying, Uniforms> program;
-    program.onVertex([](const Uniforms& uniform, const Vertex& in, Varying& out)
+    auto vertex_shader = [](const Uniforms& uniform, const Vertex& in, Varying& out)
     {
         out.world_position = Vec3(uniform.model * Vec4(in.position, 1.0f));
         out.position = uniform.proj * uniform.view * uniform.model * Vec4(in.position, 1.0f);
@@ -100,40 +124,48 @@ int main(int argc, char** argv)
         auto tangent = Vec3(in.tangent);
         auto bitangent = cross(in.normal, tangent) * in.tangent.w;
         out.TBN = Mat3( model * tangent, model * bitangent, model * in.normal);
-    });
+    };
 
-    program.onFragment([](const Uniforms& uniform, const Varying& in, Vec4& out)
+    /* shades packets of 4x2 fragments at once; material textures select the mip level of each lane from its uv derivatives,
+       only the lanes of mask are sampled */
+    auto fragment_shader = [](const Uniforms& uniform, const FragmentPacket<Varying>& in, unsigned int mask, Vec4Packet<>& out)
     {
-        auto n = normalize(in.TBN * normalize( Vec3(texture(uniform.material.normal, in.uv) / 255.0f) * 2.0f - 1.0f ) );
-        Vec3 v = normalize(uniform.viewPos - in.world_position);
-        float nv = std::max(dot(n, v), 0.0f);
-        Vec3 r = reflect(-v, n);
+        Vec3Packet<> world_position = load(in, &Varying::world_position);
+        Vec2Packet<> uv = load(in, &Varying::uv);
+        auto TBN = load(in, &Varying::TBN);
+
+        auto n = normalize(TBN * normalize( Vec3Packet<>(texture(uniform.material.normal, uv, mask) / 255.0f) * 2.0f - Packet<>(1.0f) ) );
+        Vec3Packet<> v = normalize(uniform.viewPos - world_position);
+        Packet<> nv = max(dot(n, v), Packet<>(0.0f));
+        Vec3Packet<> r = reflect(-v, n);
 
         /* material properties */
-        Vec3 albedo = Vec3(texture(uniform.material.albedo, in.uv) / 255.0f);
-        auto metal_rough = texture(uniform.material.metallic_roughness, in.uv) / 255.0f;
-        float metallic = metal_rough.z;
-        float roughness = metal_rough.y;
+        Vec3Packet<> albedo = Vec3Packet<>(texture(uniform.material.albedo, uv, mask) / 255.0f);
+        auto metal_rough = texture(uniform.material.metallic_roughness, uv, mask) / 255.0f;
+        Packet<> metallic = metal_rough.z;
+        Packet<> roughness = metal_rough.y;
 
         /* determine metallic / diffuse color values */
         const Vec3 DIELECTRIC_F0 = {0.04f, 0.04f, 0.04f};
-        Vec3 f0 = mix(DIELECTRIC_F0, albedo, metallic);
-        albedo = albedo * (1.0 - DIELECTRIC_F0.x) * (1.0 - metallic);
+        Vec3Packet<> f0 = (1.0f - metallic) * DIELECTRIC_F0 + metallic * albedo;
+        albedo = albedo * (1.0f - DIELECTRIC_F0.x) * (1.0f - metallic);
 
         /* retrieve irradiance and radiance from precomputed maps */
-        Vec3 radiance = Vec3(textureLod(uniform.prefilter_radiance, equirectangularUV(r), roughness * uniform.prefilter_radiance.m_texture->num_mipmaps()));
-        Vec3 irradiance = Vec3(texture(uniform.irradiance, equirectangularUV(n)));
-        auto env_brdf  = Vec2(texture(uniform.brdf, Vec2(nv, roughness)));
+        Vec3Packet<> radiance = Vec3Packet<>(textureLod(uniform.prefilter_radiance, equirectangularUV(r), roughness * float(uniform.prefilter_radiance.m_texture->num_mipmaps()), mask));
+        Vec3Packet<> irradiance = Vec3Packet<>(texture(uniform.irradiance, equirectangularUV(n), mask));
+        auto env_brdf = Vec2Packet<>(texture(uniform.brdf, Vec2Packet<>(nv, roughness), mask));
 
         /* https://www.jcgt.org/published/0008/01/03/paper.pdf */
-        Vec3 Fr = max(Vec3(1.0 - roughness), f0) - f0;
-        Vec3 k_S = f0 + Fr * pow(1.0 - nv, 5.0);
-        auto fss_ess = (k_S * env_brdf.x + Vec3(env_brdf.y));
+        Vec3Packet<> Fr = max(Vec3Packet<>(1.0f - roughness), f0) - f0;
+        Vec3Packet<> k_S = f0 + Fr * pow(1.0f - nv, 5.0f);
+        auto fss_ess = (k_S * env_brdf.x + Vec3Packet<>(env_brdf.y));
 
-        Vec3 illuminance = (fss_ess * radiance + albedo * irradiance);
+        Vec3Packet<> illuminance = (fss_ess * radiance + albedo * irradiance);
 
-        out = Vec4(illuminance, 1.0f);
-    });
+        out = Vec4Packet<>(illuminance, 1.0f);
+    };
+
+    auto program = make_program<Vertex, Varying, Uniforms>(vertex_shader, packet_shader(fragment_shader));
 
     /* set uniforms */
     auto& uniforms = program.uniforms();
@@ -175,7 +207,7 @@ int main(int argc, char** argv)
             uniforms.material.metallic_roughness = materials[i].map_metallic_roughness;
             uniforms.material.normal = materials[i].map_normal;
 
-            TIME_MS(rasterizer.draw(program, buffers[i]));
+            TIME_MS(rasterizer.draw(uniforms.proj * uniforms.view * uniforms.model, program, buffers[i]));
         }
 
         window.swap(rasterizer.framebuffer());
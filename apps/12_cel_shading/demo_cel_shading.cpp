@@ -72,7 +72,7 @@ float linearizeDepth(float depth, const Vec2& nearFar)
     return linearDepth;
 }
 
-void renderEdge(DefaultFramebuffer& fb)
+void renderEdge(JobSystem& jobs, DefaultFramebuffer& fb)
 {
     auto& color = fb.color();
     Sampler<float> depth = fb.depth();
@@ -89,38 +89,42 @@ void renderEdge(DefaultFramebuffer& fb)
     step_u *= pixelWidth;
     step_r *= pixelWidth;
 
-    float depth_x[3];
-    float depth_y[3];
-
-    for(int x = 0; x < texSize.x; x++)
+    /* rows are independent, process them in parallel on the rasterizer's job system */
+    jobs.parallel_for(texSize.y, 16, [&](std::size_t begin, std::size_t end)
     {
-        for(int y = 0; y < texSize.y; y++)
+        float depth_x[3];
+        float depth_y[3];
+
+        for(int y = begin; y < static_cast<int>(end); y++)
         {
-            Vec2 uv = (Vec2(x, y) + Vec2(0.5f, 0.5f)) / texSize;
+            for(int x = 0; x < texSize.x; x++)
+            {
+                Vec2 uv = (Vec2(x, y) + Vec2(0.5f, 0.5f)) / texSize;
 
-            depth_x[1] = linearizeDepth(texture(depth, uv), nearFar);
-            depth_y[1] = depth_x[1];
+                depth_x[1] = linearizeDepth(texture(depth, uv), nearFar);
+                depth_y[1] = depth_x[1];
 
-            depth_x[2] = linearizeDepth(texture(depth, uv + step_r), nearFar);
-            depth_x[0] = linearizeDepth(texture(depth, uv - step_r), nearFar);
+                depth_x[2] = linearizeDepth(texture(depth, uv + step_r), nearFar);
+                depth_x[0] = linearizeDepth(texture(depth, uv - step_r), nearFar);
 
-            depth_y[2] = linearizeDepth(texture(depth, uv + step_u), nearFar);
-            depth_y[0] = linearizeDepth(texture(depth, uv - step_u), nearFar);
+                depth_y[2] = linearizeDepth(texture(depth, uv + step_u), nearFar);
+                depth_y[0] = linearizeDepth(texture(depth, uv - step_u), nearFar);
 
-            /* hacky version of an edge detection */
-            float grad_r = abs(depth_x[1] - depth_x[2]);
-            float grad_l = abs(depth_x[1] - depth_x[0]);
-            float x_grad = std::max(grad_r, grad_l);
+                /* hacky version of an edge detection */
+                float grad_r = abs(depth_x[1] - depth_x[2]);
+                float grad_l = abs(depth_x[1] - depth_x[0]);
+                float x_grad = std::max(grad_r, grad_l);
 
-            float grad_u = abs(depth_y[1] - depth_y[2]);
-            float grad_d = abs(depth_y[1] - depth_y[0]);
-            float y_grad = std::max(grad_u, grad_d);
+                float grad_u = abs(depth_y[1] - depth_y[2]);
+                float grad_d = abs(depth_y[1] - depth_y[0]);
+                float y_grad = std::max(grad_u, grad_d);
 
-            /* magnitude threshold to detect edge */
-            float threshold = 0.075f;
-            color(x, y) = length(Vec2(x_grad, y_grad)) > threshold ? RGBA8(0, 0, 0, 255) : color(x, y);
+                /* magnitude threshold to detect edge */
+                float threshold = 0.075f;
+                color(x, y) = length(Vec2(x_grad, y_grad)) > threshold ? RGBA8(0, 0, 0, 255) : color(x, y);
+            }
         }
-    }
+    });
 }
 
 int main(int argc, char** argv)
@@ -219,7 +223,7 @@ int main(int argc, char** argv)
         /* PASS 2: use depth buffer for edge detection */
         if(uniforms.renderEdge)
         {
-            TIME_MS(renderEdge(rasterizer.framebuffer()));
+            TIME_MS(renderEdge(rasterizer.jobs(), rasterizer.framebuffer()));
         }
 
         window.swap(rasterizer.framebuffer());
@@ -0,0 +1,120 @@
+#include <cstdlib>
+
+#include <renderer.h>
+#include <math/matrix4.h>
+
+#include <gl_window.h>
+
+#include <timing.h>
+
+#include <algorithm>
+#include <vector>
+
+
+struct Vertex
+{
+    Vec3 pos;
+    Vec3 normal;
+};
+
+struct Varying
+{
+    Vec4 position;
+    Vec3 color;
+
+    VARYING( position, color );
+};
+
+struct Uniforms
+{
+    Mat4 view;
+    Mat4 proj;
+    Mat4 rotation;
+};
+
+/* per instance data, passed to the vertex shader of instanced draw calls */
+struct Instance
+{
+    Vec3 offset;
+    Vec3 color;
+};
+
+
+int main(int argc, char** argv)
+{
+    Renderer rasterizer(1280, 720);
+
+    /*========== Setup Shader Program ========*/
+    /* the vertex shader of instanced draws additionally receives the data of its instance */
+    auto program = make_program<Vertex, Varying, Uniforms>(
+        [](const Uniforms& uniform, const Vertex& in, const Instance& instance, Varying& out)
+        {
+            Vec4 position = uniform.rotation * Vec4(in.pos, 1.0f);
+            Vec4 normal = uniform.rotation * Vec4(in.normal, 0.0f);
+
+            out.position = uniform.proj * uniform.view * Vec4(Vec3(position.x, position.y, position.z) + instance.offset, 1.0f);
+            out.color = instance.color * (0.4f + 0.6f * std::max(normal.y * 0.6f + normal.z * 0.8f, 0.0f));
+        },
+        [](const Uniforms& uniform, const Varying& in, Vec4& out)
+        {
+            out = Vec4(in.color, 1.0f);
+        });
+
+    auto& uniforms = program.uniforms();
+    uniforms.proj = Mat4::perspective(radians(45.0f), 1280.0f/720.0f, 1.0, 60.0);
+    uniforms.view = Mat4::translation(-Vec3{0, 0, 32.0}) * Mat4::rotationX(radians(35.0f));
+
+
+    /*========== Setup Buffer Data ========*/
+    /* cube with a normal per face */
+    BufferIndexed<Vertex, unsigned int> buffer_cube;
+    buffer_cube.primitive = ePrimitive::TRIANGLES;
+
+    const Vec3 normals[6] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+    for(const Vec3& n : normals)
+    {
+        /* corners counter-clockwise seen from outside (u x v = n) */
+        Vec3 u(n.y, n.z, n.x);
+        Vec3 v = cross(n, u);
+
+        unsigned int base = static_cast<unsigned int>(buffer_cube.vertices.size());
+        buffer_cube.vertices.push_back({ (n - u - v) * 0.3f, n });
+        buffer_cube.vertices.push_back({ (n + u - v) * 0.3f, n });
+        buffer_cube.vertices.push_back({ (n + u + v) * 0.3f, n });
+        buffer_cube.vertices.push_back({ (n - u + v) * 0.3f, n });
+        buffer_cube.indices.insert(buffer_cube.indices.end(), { base, base + 1, base + 2,   base + 2, base + 3, base });
+    }
+
+    /* grid of cubes, all drawn by one instanced draw call */
+    constexpr int grid_size = 24;
+    std::vector<Instance> cubes;
+    for(int z = 0; z < grid_size; z++)
+    {
+        for(int x = 0; x < grid_size; x++)
+        {
+            float s = static_cast<float>(x) / (grid_size - 1);
+            float t = static_cast<float>(z) / (grid_size - 1);
+            cubes.push_back({ Vec3(x - 0.5f * (grid_size - 1), 0.0f, z - 0.5f * (grid_size - 1)), Vec3(s, 0.5f, t) });
+        }
+    }
+
+    /*========== OpenGL/GLFW Viewer ========*/
+    Window window("Software-Rasterizer Instancing", 1280, 720);
+
+    window.onDraw([&](Window& window, float dt)
+    {
+        rasterizer.framebuffer().clear(Vec4(0, 0, 0, 1));
+
+        static float time = 0.0;
+        time += dt;
+
+        uniforms.rotation = Mat4::rotationY(radians(time*45.0f)) * Mat4::rotationX(radians(time*30.0f));
+        TIME_MS(rasterizer.draw_instanced(program, buffer_cube, cubes));
+
+        window.swap(rasterizer.framebuffer());
+    });
+
+    window.run();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace asset
+{
+
+/*
+ * Offline optimization of indexed meshes (after loadObj)
+ * -> optimizeVertexCache: reorders triangles for post-transform vertex reuse (Forsyth's linear-speed vertex cache optimisation)
+ *    consecutive triangles also share edges, so they tend to cover neighbouring pixels
+ * -> optimizeVertexFetch: reorders vertices by first use, so vertex fetches walk the vertex array front to back
+ * -> acmr: average cache miss ratio (transformed vertices per triangle) of a simulated FIFO cache
+*/
+struct MeshOptimizationStats
+{
+    float acmr_before = 0.0f;
+    float acmr_after = 0.0f;
+};
+
+
+/* simulated post-transform cache misses per triangle, between 0.5 (best case for large meshes) and 3.0 */
+template<typename Index>
+float acmr(const std::vector<Index>& indices, std::size_t vertexCount, std::size_t cacheSize = 32)
+{
+    if(indices.size() < 3) return 0.0f;
+
+    /* FIFO: a vertex is cached if it was inserted less than cacheSize misses ago */
+    std::vector<std::size_t> inserted(vertexCount, 0);
+    std::size_t misses = 0;
+    for(Index index : indices)
+    {
+        if(inserted[index] == 0 || misses - inserted[index] + 1 > cacheSize)
+        {
+            misses++;
+            inserted[index] = misses;
+        }
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+
+namespace detail
+{
+
+/* vertex score of Forsyth's algorithm: recently used vertices and vertices with few remaining triangles are preferred */
+inline float vertexScore(int cachePosition, unsigned int remainingTriangles, std::size_t cacheSize)
+{
+    if(remainingTriangles == 0) return -1.0f;
+
+    float score = 0.0f;
+    if(cachePosition >= 0)
+    {
+        /* the last triangle's vertices get a fixed score, so the next triangle doesn't just reuse its edge */
+        if(cachePosition < 3) score = 0.75f;
+        else score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / static_cast<float>(cacheSize - 3), 1.5f);
+    }
+
+    return score + 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+}
+
+}
+
+
+/* reorders the triangles of indices in place; vertexCount is the size of the referenced vertex array */
+template<typename Index>
+void optimizeVertexCache(std::vector<Index>& indices, std::size_t vertexCount, std::size_t cacheSize = 32)
+{
+    const std::size_t triangleCount = indices.size() / 3;
+    if(triangleCount == 0 || cacheSize <= 3) return;
+
+    /* triangles adjacent to each vertex */
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for(Index index : indices) remaining[index]++;
+
+    std::vector<std::size_t> offsets(vertexCount + 1, 0);
+    for(std::size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<std::size_t> adjacency(indices.size());
+    {
+        std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+        for(std::size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for(std::size_t v = 0; v < vertexCount; v++) vertexScores[v] = detail::vertexScore(-1, remaining[v], cacheSize);
+
+    std::vector<float> triangleScores(triangleCount);
+    for(std::size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScores[t] = vertexScores[indices[3*t]] + vertexScores[indices[3*t + 1]] + vertexScores[indices[3*t + 2]];
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<Index> result;
+    result.reserve(indices.size());
+
+    /* LRU cache, temporarily holding 3 more entries while a triangle is added */
+    std::vector<Index> cache;
+    std::vector<Index> next;
+    cache.reserve(cacheSize + 3);
+    next.reserve(cacheSize + 3);
+
+    std::size_t best = 0;
+    std::size_t cursor = 0;
+    for(std::size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+    {
+        /* nothing in the cache has triangles left: continue with the next triangle in input order */
+        if(best == std::numeric_limits<std::size_t>::max())
+        {
+            while(emitted[cursor]) cursor++;
+            best = cursor;
+        }
+
+        emitted[best] = true;
+
+        next.clear();
+        for(std::size_t k = 0; k < 3; k++)
+        {
+            Index index = indices[3*best + k];
+            result.push_back(index);
+            next.push_back(index);
+
+            /* remove the triangle from the vertex' adjacency */
+            auto begin = adjacency.begin() + offsets[index];
+            auto end = begin + remaining[index];
+            std::iter_swap(std::find(begin, end, best), end - 1);
+            remaining[index]--;
+        }
+
+        for(Index index : cache)
+        {
+            if(index != next[0] && index != next[1] && index != next[2]) next.push_back(index);
+        }
+
+        /* rescore the vertices in the cache (and the ones just evicted) and their triangles */
+        for(std::size_t i = 0; i < next.size(); i++)
+        {
+            cachePosition[next[i]] = i < cacheSize ? static_cast<int>(i) : -1;
+        }
+
+        for(Index index : next)
+        {
+            float score = detail::vertexScore(cachePosition[index], remaining[index], cacheSize);
+            float delta = score - vertexScores[index];
+            vertexScores[index] = score;
+
+            for(std::size_t a = offsets[index]; a < offsets[index] + remaining[index]; a++)
+            {
+                triangleScores[adjacency[a]] += delta;
+            }
+        }
+
+        next.resize(std::min(next.size(), cacheSize));
+        std::swap(cache, next);
+
+        best = std::numeric_limits<std::size_t>::max();
+        float bestScore = -1.0f;
+        for(Index index : cache)
+        {
+            for(std::size_t a = offsets[index]; a < offsets[index] + remaining[index]; a++)
+            {
+                std::size_t t = adjacency[a];
+                if(triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    indices = std::move(result);
+}
+
+
+/* reorders vertices by their first use in indexLists (in order) and remaps the indices; unreferenced vertices are moved to the end */
+template<typename Vertex, typename Index>
+void optimizeVertexFetch(std::vector<Vertex>& vertices, const std::vector<std::vector<Index>*>& indexLists)
+{
+    constexpr Index unused = std::numeric_limits<Index>::max();
+    std::vector<Index> remap(vertices.size(), unused);
+
+    Index count = 0;
+    for(auto* indices : indexLists)
+    {
+        for(Index& index : *indices)
+        {
+            if(remap[index] == unused) remap[index] = count++;
+            index = remap[index];
+        }
+    }
+
+    for(Index& index : remap)
+    {
+        if(index == unused) index = count++;
+    }
+
+    std::vector<Vertex> reordered(vertices.size());
+    for(std::size_t v = 0; v < vertices.size(); v++) reordered[remap[v]] = vertices[v];
+    vertices = std::move(reordered);
+}
+
+
+/* optimizes every material group of the mesh for the vertex cache, then the shared vertex array for fetch locality */
+template<typename Mesh>
+MeshOptimizationStats optimizeMesh(Mesh& mesh, std::size_t cacheSize = 32)
+{
+    using IndexType = typename Mesh::IndexType;
+
+    MeshOptimizationStats stats;
+    std::size_t triangles = 0;
+    std::vector<std::vector<IndexType>*> indexLists;
+
+    for(auto& group : mesh.materialGroups())
+    {
+        std::size_t count = group.indices.size() / 3;
+        stats.acmr_before += acmr(group.indices, mesh.vertices().size(), cacheSize) * count;
+
+        optimizeVertexCache(group.indices, mesh.vertices().size(), cacheSize);
+
+        stats.acmr_after += acmr(group.indices, mesh.vertices().size(), cacheSize) * count;
+        triangles += count;
+        indexLists.push_back(&group.indices);
+    }
+
+    optimizeVertexFetch(mesh.vertices(), indexLists);
+
+    if(triangles > 0)
+    {
+        stats.acmr_before /= triangles;
+        stats.acmr_after /= triangles;
+    }
+
+    return stats;
+}
+
+}
@@ -16,6 +16,7 @@ iterate through meshes
 #include <math/vector3.h>
 #include <math/vector4.h>
 #include <texture.h>
+#include <buffer.h>
 
 #include <string>
 #include <vector>
@@ -104,12 +105,14 @@ public:
     ~Mesh() = default;
 
     std::vector<VertexType>& vertices() { return mVertexData; }
+    Bounds& bounds() { return mBounds; }
     template<typename T = Mat, typename = HasMaterial<T>> T& material(unsigned idx = 0) { assert(idx < mMaterialGroups.size()); return mMaterialGroups[idx].material; }
     template<typename T = Mat, typename = HasMaterial<T>> std::vector<MaterialGroup>& materialGroups() { return mMaterialGroups; }
 
 private:
     std::vector<VertexType> mVertexData;
     std::vector<MaterialGroup> mMaterialGroups;
+    Bounds mBounds;
 };
 
 /*========================== Model ==========================*/
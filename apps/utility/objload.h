@@ -8,6 +8,47 @@ namespace asset
 namespace detail
 {
 
+/* identity of an obj vertex for welding; only indices of attributes loaded into the vertex type are compared */
+struct VertexKey
+{
+    int position = -1;
+    int normal = -1;
+    int texcoord = -1;
+
+    bool operator==(const VertexKey&) const = default;
+};
+
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey& key) const
+    {
+        size_t hash = std::hash<int>()(key.position);
+        hash ^= std::hash<int>()(key.normal) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        hash ^= std::hash<int>()(key.texcoord) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
+
+template<typename VertexType>
+VertexKey vertexKey(const tinyobj::index_t& idx)
+{
+    /* colors are stored per position */
+    VertexKey key;
+    key.position = idx.vertex_index;
+
+    if constexpr (detail::has_member<VertexType>::normal::value)
+    {
+        key.normal = idx.normal_index;
+    }
+
+    if constexpr (detail::has_member<VertexType>::texcoord::value)
+    {
+        key.texcoord = idx.texcoord_index;
+    }
+
+    return key;
+}
+
 template<typename VertexType>
 void loadVertex(VertexType& vertex, const tinyobj::attrib_t& attrib, const tinyobj::index_t& idx, const std::filesystem::path& filepath)
 {
@@ -390,9 +431,13 @@ void loadMaterial(MaterialType& material, const tinyobj::material_t& loaded, con
 }
 
 
-/* TODO: this function is quite a mess */
+/*
+ * TODO: this function is quite a mess
+ * -> weld: face corners referencing the same obj vertex (all attributes present in the vertex type) share one vertex;
+ *          otherwise every face corner gets its own vertex
+*/
 template<typename Mesh>
-Model<Mesh> loadObj(const std::filesystem::path& filepath, bool warnings = false)
+Model<Mesh> loadObj(const std::filesystem::path& filepath, bool warnings = false, bool weld = true)
 {
     if(!std::filesystem::exists(filepath))
     {
@@ -446,24 +491,35 @@ Model<Mesh> loadObj(const std::filesystem::path& filepath, bool warnings = false
             auto& mesh = model.meshes().emplace_back();
             size_t num_faces = shape.mesh.num_face_vertices.size();
             std::unordered_map<unsigned int, unsigned int> materialGroups;
-            std::vector<int> origIdx(num_faces * 3, 0);
-            std::vector<Vec3> tangents(num_faces * 3, {0, 0, 0});
-            std::vector<Vec3> bitangents(num_faces * 3, {0, 0, 0});
+            std::vector<int> origIdx;
+            std::vector<Vec3> tangents(attrib.vertices.size() / 3, {0, 0, 0});
+            std::vector<Vec3> bitangents(attrib.vertices.size() / 3, {0, 0, 0});
 
             auto& vertices = mesh.vertices();
-            vertices.resize(num_faces * 3);
+            vertices.reserve(num_faces * 3);
+            origIdx.reserve(num_faces * 3);
+
+            std::unordered_map<detail::VertexKey, unsigned int, detail::VertexKeyHash> uniqueVertices;
+            if(weld) uniqueVertices.reserve(num_faces * 3);
 
             size_t index_offset = 0;
             for(size_t f = 0; f < num_faces; f++)
             {
+                unsigned int face[3];
                 for(size_t v = 0; v < 3; v++)
                 {
                     tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
-                    origIdx[index_offset + v] = idx.vertex_index;
 
-                    auto& vertex = vertices[index_offset + v];
+                    face[v] = static_cast<unsigned int>(vertices.size());
+                    if(weld)
+                    {
+                        auto [it, inserted] = uniqueVertices.try_emplace(detail::vertexKey<typename Mesh::VertexType>(idx), face[v]);
+                        face[v] = it->second;
+                        if(!inserted) continue;
+                    }
 
-                    detail::loadVertex(vertex, attrib, idx, filepath);
+                    origIdx.push_back(idx.vertex_index);
+                    detail::loadVertex(vertices.emplace_back(), attrib, idx, filepath);
                 }
 
                 if constexpr (!std::is_empty_v<typename Mesh::MaterialType>)
@@ -479,11 +535,7 @@ Model<Mesh> loadObj(const std::filesystem::path& filepath, bool warnings = false
 
                     auto& materialIndices = meshGroups[materialGroups[matIdx]];
 
-                    materialIndices.indices.insert(materialIndices.indices.end(), {
-                                                       static_cast<unsigned int>(index_offset + 0),
-                                                       static_cast<unsigned int>(index_offset + 1),
-                                                       static_cast<unsigned int>(index_offset + 2)
-                                                   });
+                    materialIndices.indices.insert(materialIndices.indices.end(), { face[0], face[1], face[2] });
                 }
 
                 if constexpr (detail::has_member<typename Mesh::VertexType>::tangent::value)
@@ -493,9 +545,9 @@ Model<Mesh> loadObj(const std::filesystem::path& filepath, bool warnings = false
                         throw std::runtime_error("Tangent space calculation requires texture coordinates and normals (" + filepath.string() + ")");
                     }
 
-                    auto& v1 = vertices[index_offset + 0];
-                    auto& v2 = vertices[index_offset + 1];
-                    auto& v3 = vertices[index_offset + 2];
+                    auto& v1 = vertices[face[0]];
+                    auto& v2 = vertices[face[1]];
+                    auto& v3 = vertices[face[2]];
 
                     auto e1 = v2.position - v1.position;
                     auto e2 = v3.position - v1.position;
@@ -528,6 +580,12 @@ Model<Mesh> loadObj(const std::filesystem::path& filepath, bool warnings = false
                 index_offset += 3;
             }
 
+            vertices.shrink_to_fit();
+            if constexpr (detail::has_member<typename Mesh::VertexType>::position::value)
+            {
+                mesh.bounds() = compute_bounds(vertices);
+            }
+
             if constexpr (detail::has_member<typename Mesh::VertexType>::tangent::value)
             {
                 for(unsigned int i = 0; i < vertices.size(); i++)
@@ -1,5 +1,11 @@
 #pragma once
 
+#include "math/vector3.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
 #include <vector>
 
 enum class ePrimitive
@@ -8,11 +14,24 @@ enum class ePrimitive
     LINES
 };
 
+/* model space bounding volumes of a buffer (axis-aligned box and enclosing sphere) */
+struct Bounds
+{
+    Vec3 min;
+    Vec3 max;
+
+    Vec3 center;
+    float radius = 0.0f;
+};
+
 template <typename Vert>
 struct Buffer
 {
     ePrimitive primitive = ePrimitive::TRIANGLES;
     std::vector<Vert> vertices;
+
+    /* optional; draws with a model-view-projection matrix are skipped if the bounds lie outside of the view frustum */
+    std::optional<Bounds> bounds;
 };
 
 
@@ -21,3 +40,32 @@ struct BufferIndexed : public Buffer<Vert>
 {
     std::vector<Ind> indices;
 };
+
+
+/* bounds of the (Vec3) vertex positions; the sphere is centered at the box center */
+template<typename Vert>
+Bounds compute_bounds(const std::vector<Vert>& vertices)
+{
+    Bounds bounds;
+    if(vertices.empty()) return bounds;
+
+    bounds.min = Vec3(std::numeric_limits<float>::max());
+    bounds.max = Vec3(std::numeric_limits<float>::lowest());
+    for(const auto& vertex : vertices)
+    {
+        bounds.min = Vec3(std::min(bounds.min.x, vertex.position.x), std::min(bounds.min.y, vertex.position.y), std::min(bounds.min.z, vertex.position.z));
+        bounds.max = Vec3(std::max(bounds.max.x, vertex.position.x), std::max(bounds.max.y, vertex.position.y), std::max(bounds.max.z, vertex.position.z));
+    }
+
+    bounds.center = 0.5f * (bounds.min + bounds.max);
+
+    float radius_squared = 0.0f;
+    for(const auto& vertex : vertices)
+    {
+        Vec3 d = Vec3(vertex.position) - bounds.center;
+        radius_squared = std::max(radius_squared, dot(d, d));
+    }
+
+    bounds.radius = std::sqrt(radius_squared);
+    return bounds;
+}
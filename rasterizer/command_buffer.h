@@ -0,0 +1,160 @@
+#pragma once
+
+#include "renderer.h"
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <typeindex>
+#include <vector>
+
+/*
+ * Recorded sequence of draws, clears, uniform updates and framebuffer binds, executed with Renderer::submit
+ * -> commands reference programs, buffers and framebuffers, which have to outlive the submission
+ * -> draws render to the framebuffer (and with the options) bound when they are recorded;
+ *    initially the default framebuffer and the options of the renderer at submission
+ * -> consecutive draws are pipelined: the vertex stage of a draw runs on the job system while the draw before it is rasterized,
+ *    all other commands wait for the preceding draws to finish
+ *    (so vertex shaders must not read targets written by the draw right before them)
+ * -> draws are executed in recorded order; with depth ties or blending a reordering would change the result
+*/
+struct CommandBuffer
+{
+    /* removes all commands and binds the default framebuffer */
+    void reset()
+    {
+        m_commands.clear();
+        m_target = Target();
+    }
+
+    template<typename... Targets>
+    void bind(Framebuffer<Targets...>& fb)
+    {
+        m_target.framebuffer = &fb;
+        m_target.type = typeid(Framebuffer<Targets...>);
+        m_target.options.reset();
+        m_target.clear = [&fb](Renderer&, const RGBA8& color) { fb.clear(color); };
+    }
+
+    template<typename... Targets>
+    void bind(Framebuffer<Targets...>& fb, const Renderer::Options& options)
+    {
+        bind(fb);
+        m_target.options = options;
+    }
+
+    void bind_default()
+    {
+        m_target = Target();
+    }
+
+    /* clears the bound framebuffer */
+    void clear(const RGBA8& color = RGBA8())
+    {
+        m_commands.emplace_back().execute = [clear = m_target.clear, color](Renderer& renderer) { clear(renderer, color); };
+    }
+
+    void clear(const Vec4& color)
+    {
+        clear(RGBA8(color * 255));
+    }
+
+    /* copies uniforms into the program when the command is executed */
+    template<typename ProgramType, typename Uniforms>
+    void set_uniforms(ProgramType& program, const Uniforms& uniforms)
+    {
+        m_commands.emplace_back().execute = [&program, uniforms](Renderer&) { program.uniforms() = uniforms; };
+    }
+
+    /* arbitrary update of application state between draws (e.g. material uniforms) */
+    void execute(std::function<void ()> update)
+    {
+        m_commands.emplace_back().execute = [update = std::move(update)](Renderer&) { update(); };
+    }
+
+    /* throws std::logic_error if the program renders to other targets than the bound framebuffer */
+    template<typename ProgramType, typename BufferType>
+    void draw(const ProgramType& program, const BufferType& buffer)
+    {
+        record_draw(std::nullopt, program, buffer);
+    }
+
+    /* draw with frustum (and meshlet) culling, see Renderer::draw */
+    template<typename ProgramType, typename BufferType>
+    void draw(const Mat4& mvp, const ProgramType& program, const BufferType& buffer)
+    {
+        record_draw(detail::Frustum(mvp), program, buffer);
+    }
+
+    std::size_t size() const { return m_commands.size(); }
+
+private:
+    struct Command
+    {
+        /* all commands but draws */
+        std::function<void (Renderer&)> execute;
+
+        /* draws: prepare returns false if the draw was culled, shade may run concurrently to other draws */
+        std::function<bool (Renderer&)> prepare;
+        std::function<void (Renderer&)> shade;
+        std::function<void (Renderer&)> rasterize;
+    };
+
+    struct Target
+    {
+        /* nullptr: default framebuffer of the renderer */
+        void* framebuffer = nullptr;
+        std::type_index type = typeid(DefaultFramebuffer);
+        std::optional<Renderer::Options> options;
+
+        std::function<void (Renderer&, const RGBA8&)> clear = [](Renderer& renderer, const RGBA8& color) { renderer.framebuffer().clear(color); };
+    };
+
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename BufferType, typename... Targets>
+    void record_draw(std::optional<detail::Frustum> frustum, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const BufferType& buffer)
+    {
+        using FramebufferType = Framebuffer<Targets...>;
+        using Prepared = Renderer::PreparedDraw<Varying, typename Renderer::IndexType<BufferType>::type>;
+
+        /* the bound framebuffer has to match the targets of the program, submit would render to it as FramebufferType */
+        if(m_target.type != typeid(FramebufferType)) throw std::logic_error("CommandBuffer: draw of a program for other targets than the bound framebuffer");
+        assert(detail::is_shader_set(program.m_vertShader));
+        assert(detail::is_shader_set(program.m_fragShader));
+
+        FramebufferType* fb = static_cast<FramebufferType*>(m_target.framebuffer);
+        std::optional<Renderer::Options> options = m_target.options;
+
+        /* filled by prepare, used by the other steps of the draw */
+        auto prepared = std::make_shared<std::optional<Prepared>>();
+
+        Command& command = m_commands.emplace_back();
+        command.prepare = [&buffer, frustum, options, prepared](Renderer& renderer)
+        {
+            *prepared = renderer.prepare_draw<Varying>(buffer, frustum ? &*frustum : nullptr, options ? *options : renderer.m_options);
+            return prepared->has_value();
+        };
+
+        command.shade = [&program, &buffer, options, prepared](Renderer& renderer)
+        {
+            renderer.shade_draw(**prepared, program, buffer, options ? *options : renderer.m_options);
+        };
+
+        command.rasterize = [&program, &buffer, fb, options, prepared](Renderer& renderer)
+        {
+            FramebufferType* target = fb;
+            if constexpr (std::is_same_v<FramebufferType, DefaultFramebuffer>)
+            {
+                if(!target) target = &renderer.m_framebuffer;
+            }
+
+            renderer.rasterize_draw(**prepared, program, buffer, *target, options ? *options : renderer.m_options);
+        };
+    }
+
+    std::vector<Command> m_commands;
+    Target m_target;
+
+    friend struct Renderer;
+};
@@ -0,0 +1,319 @@
+#pragma once
+
+#include "detail/triangle_setup.h"
+#include "detail/tuple_helper.h"
+
+#include "math/vector2.h"
+#include "math/vector3.h"
+#include "math/packet.h"
+
+#include "program.h"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace detail
+{
+    /*
+     * Perspective correction of a pair of block rows (x, y) ... (x + width - 1, y + 1), computed by the raster kernel (see RasterKernel::perspective)
+     * -> w[r][i] is bc_scale / (1/w) at the center of pixel (x + i, y + r)
+     * -> x is a multiple of the block size and y even, so the rows hold all 2x2 quads of their pixels
+    */
+    struct QuadRows
+    {
+        static constexpr int width = 8;
+
+        int x = 0;
+        int y = 0;
+        std::array<std::array<float, width>, 2> w;
+
+        float operator()(int px, int py) const
+        {
+            assert(px >= x && px < x + width && py >= y && py <= y + 1);
+            return w[py - y][px - x];
+        }
+    };
+
+    template<typename Varying>
+    struct TriangleQuad;
+
+    /* quad of the fragment shaded by this thread, nullptr if no triangle with these varyings is rasterized */
+    template<typename Varying>
+    inline thread_local const TriangleQuad<Varying>* current_quad = nullptr;
+
+    /* quad of the fragment shaded by this thread without the type of its varyings, for coordinates alone (see texture(sampler, uv)) */
+    struct FragmentQuad
+    {
+        /* derivatives of the Vec2 varying closest to uv at the fragment (see TriangleQuad::find_uv_derivatives), false without Vec2 varyings */
+        bool (*uv_derivatives)(const FragmentQuad& quad, const Vec2& uv, Vec2& ddx, Vec2& ddy) = nullptr;
+    };
+
+    inline thread_local const FragmentQuad* current_fragment_quad = nullptr;
+
+    /*
+     * 2x2 pixel quads of a triangle, source of the screen space derivatives of its fragments; current quad of the thread during its lifetime
+     * -> quads are aligned to even pixel coordinates: dFdx is the difference of the right and the left pixel in the row of the fragment,
+     *    dFdy of the upper and the lower pixel in its column (y pointing up)
+     * -> the other pixels of the quad are evaluated only when a derivative is requested, covered or not (helper lanes),
+     *    so shaders without derivatives pay nothing for them
+    */
+    template<typename Varying>
+    struct TriangleQuad : FragmentQuad
+    {
+        TriangleQuad(const TriangleSetup& tri, const Varying& v_0, const Varying& v_1, const Varying& v_2)
+            : FragmentQuad{ &TriangleQuad::find_uv_derivatives }, tri(tri), v_0(v_0), v_1(v_1), v_2(v_2),
+              m_previous(current_quad<Varying>), m_previous_fragment(current_fragment_quad)
+        {
+            current_quad<Varying> = this;
+            current_fragment_quad = this;
+        }
+
+        ~TriangleQuad()
+        {
+            current_quad<Varying> = m_previous;
+            current_fragment_quad = m_previous_fragment;
+        }
+
+        TriangleQuad(const TriangleQuad&) = delete;
+        TriangleQuad& operator =(const TriangleQuad&) = delete;
+
+        /* perspective correct barycentric coordinates at the center of pixel (x, y) of the quad, which may lie outside of the triangle */
+        Vec3 barycentrics(int x, int y) const
+        {
+            float w = (*rows)(x, y);
+            return Vec3(w * static_cast<float>(tri.edge[0](x, y)) * v_0.position.w,
+                        w * static_cast<float>(tri.edge[1](x, y)) * v_1.position.w,
+                        w * static_cast<float>(tri.edge[2](x, y)) * v_2.position.w);
+        }
+
+        /* pixel of the fragment */
+        int x = 0;
+        int y = 0;
+
+        /* perspective correction of the rows of the quad */
+        const QuadRows* rows = nullptr;
+
+        /* input of the fragment shader (Varying or LazyFragment<Varying>) */
+        const void* input = nullptr;
+
+        /* interpolated varyings of the fragment, nullptr for lazy inputs */
+        const Varying* varyings = nullptr;
+
+        const TriangleSetup& tri;
+        const Varying& v_0;
+        const Varying& v_1;
+        const Varying& v_2;
+
+    private:
+        /*
+         * Derivatives of the Vec2 varying closest to uv at the fragment, differences over the quad as for dFdx
+         * -> exact for the varying uv refers to (in.uv) or has the value of (load(in, &Varying::uv), copies) and for offsets of it;
+         *    other computed coordinates are assumed to vary like it (scaled coordinates need texture(sampler, in, uv))
+        */
+        static bool find_uv_derivatives(const FragmentQuad& fragment_quad, const Vec2& uv, Vec2& ddx, Vec2& ddy)
+        {
+            const TriangleQuad& quad = static_cast<const TriangleQuad&>(fragment_quad);
+
+            /* Vec2 varying uv refers to */
+            int member = 0;
+            int uv_member = -1;
+            if(quad.varyings)
+            {
+                tuple_iter([&](const auto& value)
+                {
+                    if constexpr (std::is_same_v<std::decay_t<decltype(value)>, Vec2>)
+                    {
+                        if(&value == &uv) uv_member = member;
+                        member++;
+                    }
+                }, quad.varyings->_reflect);
+            }
+
+            /* closest Vec2 varying and its value at the fragment */
+            const Vec3 bc = quad.barycentrics(quad.x, quad.y);
+            std::array<const Vec2*, 3> closest = {};
+            Vec2 fragment;
+            float closest_distance = std::numeric_limits<float>::infinity();
+
+            member = 0;
+            tuple_iter([&](const auto& x_0, const auto& x_1, const auto& x_2)
+            {
+                if constexpr (std::is_same_v<std::decay_t<decltype(x_0)>, Vec2>)
+                {
+                    const Vec2 value = member == uv_member ? uv : bc.x * x_0 + bc.y * x_1 + bc.z * x_2;
+                    const Vec2 d = value - uv;
+                    if(dot(d, d) < closest_distance)
+                    {
+                        closest = { &x_0, &x_1, &x_2 };
+                        fragment = value;
+                        closest_distance = dot(d, d);
+                    }
+                    member++;
+                }
+            }, quad.v_0._reflect, quad.v_1._reflect, quad.v_2._reflect);
+
+            if(!closest[0]) return false;
+
+            /* as quad_difference */
+            auto difference = [&](int axis)
+            {
+                const int x_1 = axis == 0 ? quad.x ^ 1 : quad.x;
+                const int y_1 = axis == 1 ? quad.y ^ 1 : quad.y;
+                const float sign = ((axis == 0 ? quad.x : quad.y) & 1) ? -1.0f : 1.0f;
+
+                const Vec3 bc_1 = quad.barycentrics(x_1, y_1);
+                const Vec2 other = bc_1.x * *closest[0] + bc_1.y * *closest[1] + bc_1.z * *closest[2];
+                return sign * other + (-sign) * fragment;
+            };
+
+            ddx = difference(0);
+            ddy = difference(1);
+            return true;
+        }
+
+        const TriangleQuad* m_previous;
+        const FragmentQuad* m_previous_fragment;
+    };
+
+    /* varyings of a fragment shader input */
+    template<typename Input>
+    struct fragment_varying { using type = Input; };
+
+    template<typename Varying>
+    struct fragment_varying<LazyFragment<Varying>> { using type = Varying; };
+
+    /* value (member or function of the input) of the fragment with input in */
+    template<typename Varying, typename Value>
+    auto fragment_value(const Varying& in, const Value& value)
+    {
+        if constexpr (std::is_member_object_pointer_v<Value>) return in.*value;
+        else return value(in);
+    }
+
+    template<typename Varying, typename Value>
+    auto fragment_value(const LazyFragment<Varying>& in, const Value& value)
+    {
+        if constexpr (std::is_member_object_pointer_v<Value>) return load(in, value);
+        else return value(in);
+    }
+
+    /* value at pixel (x, y) of the quad; members are interpolated alone, functions receive the fully interpolated input */
+    template<typename Varying, typename Value>
+    auto quad_value(const TriangleQuad<Varying>& quad, const Varying&, const Value& value, int x, int y)
+    {
+        const Vec3 bc = quad.barycentrics(x, y);
+        if constexpr (std::is_member_object_pointer_v<Value>)
+        {
+            return bc.x * (quad.v_0.*value) + bc.y * (quad.v_1.*value) + bc.z * (quad.v_2.*value);
+        }
+        else
+        {
+            /* Varyings are never copied (_reflect refers to the members of its object) */
+            Varying other;
+            auto interpolate = [&bc](const auto& x_0, const auto& x_1, const auto& x_2, auto& result)
+            {
+                result = bc.x * x_0 + bc.y * x_1 + bc.z * x_2;
+            };
+            tuple_iter(interpolate, quad.v_0._reflect, quad.v_1._reflect, quad.v_2._reflect, other._reflect);
+
+            return value(static_cast<const Varying&>(other));
+        }
+    }
+
+    template<typename Varying, typename Value>
+    auto quad_value(const TriangleQuad<Varying>& quad, const LazyFragment<Varying>& in, const Value& value, int x, int y)
+    {
+        return fragment_value(LazyFragment<Varying>{ quad.barycentrics(x, y), in.v_0, in.v_1, in.v_2 }, value);
+    }
+
+    /* difference of value (fragment at the pixel of the fragment) towards increasing x (axis 0) or y (axis 1) in the quad of the fragment with input in */
+    template<typename Input, typename Value, typename T>
+    T quad_difference(const Input& in, const Value& value, const T& fragment, int axis)
+    {
+        using Varying = typename fragment_varying<Input>::type;
+
+        /* lines have no quads */
+        const TriangleQuad<Varying>* quad = current_quad<Varying>;
+        if(!quad) return T{};
+
+        /* values of other pixels are computed from the input of the fragment being shaded, not from copies of it */
+        assert(quad->input == &in);
+
+        const int x_1 = axis == 0 ? quad->x ^ 1 : quad->x;
+        const int y_1 = axis == 1 ? quad->y ^ 1 : quad->y;
+        const float sign = ((axis == 0 ? quad->x : quad->y) & 1) ? -1.0f : 1.0f;
+
+        /* only scalar multiplication and addition, as for interpolation */
+        T other = quad_value(*quad, in, value, x_1, y_1);
+        return sign * other + (-sign) * fragment;
+    }
+}
+
+/*
+ * Screen space derivatives in fragment shaders of triangles, dFdx(in, value) and dFdy(in, value)
+ * -> in is the input of the fragment shader (Varying or LazyFragment, see lazy_shader), value a member of the varyings
+ *    (dFdx(in, &Varying::uv)) or a function of the input (dFdx(in, [](const Varying& v) { return v.uv * 8.0f; }))
+ * -> value is evaluated at the neighbor pixel of the quad, so computed values have exact differences;
+ *    members interpolate only themselves there, functions of eager inputs all varyings (lazy inputs what they load)
+ * -> a value alone (dFdx(in.uv)) does not compile: it can not be evaluated at other pixels, packet shaders shade all of them (see packet_shader)
+ * -> line fragments have no quads, their derivatives are zero
+*/
+template<typename Input, typename Value>
+auto dFdx(const Input& in, const Value& value)
+{
+    return detail::quad_difference(in, value, detail::fragment_value(in, value), 0);
+}
+
+template<typename Input, typename Value>
+auto dFdy(const Input& in, const Value& value)
+{
+    return detail::quad_difference(in, value, detail::fragment_value(in, value), 1);
+}
+
+template<typename T>
+T dFdx(const T&)
+{
+    static_assert(sizeof(T) == 0, "dFdx(value) needs a packet; in scalar fragment shaders use dFdx(in, &Varying::member) or dFdx(in, function of the input)");
+}
+
+template<typename T>
+T dFdy(const T&)
+{
+    static_assert(sizeof(T) == 0, "dFdy(value) needs a packet; in scalar fragment shaders use dFdy(in, &Varying::member) or dFdy(in, function of the input)");
+}
+
+
+
+/*
+ * Fragment packets (see packet_shader): two 2x2 pixel quads, lane 4 * row + column with columns 0, 1 of the first quad and 2, 3 of the second;
+ * the quads need not be adjacent, but all of their pixels are shaded (helper lanes), so derivatives of any packet value are available
+ * -> as for fragments, dFdx is the difference of the right and the left pixel of the quad row, dFdy of the upper and the lower row
+*/
+inline constexpr int fragment_packet_width = 4;
+inline constexpr int fragment_packet_height = 2;
+static_assert(fragment_packet_width * fragment_packet_height == packet_size);
+
+inline Packet<> dFdx(const Packet<>& p)
+{
+    Packet<> r;
+    for(std::size_t i = 0; i < packet_size; i++) r[i] = p[i | 1] - p[i & ~std::size_t(1)];
+    return r;
+}
+
+inline Packet<> dFdy(const Packet<>& p)
+{
+    Packet<> r;
+    for(std::size_t i = 0; i < packet_size; i++) r[i] = p[i % fragment_packet_width + fragment_packet_width] - p[i % fragment_packet_width];
+    return r;
+}
+
+inline Vec2Packet<> dFdx(const Vec2Packet<>& p) { return { dFdx(p.x), dFdx(p.y) }; }
+inline Vec2Packet<> dFdy(const Vec2Packet<>& p) { return { dFdy(p.x), dFdy(p.y) }; }
+
+inline Vec3Packet<> dFdx(const Vec3Packet<>& p) { return { dFdx(p.x), dFdx(p.y), dFdx(p.z) }; }
+inline Vec3Packet<> dFdy(const Vec3Packet<>& p) { return { dFdy(p.x), dFdy(p.y), dFdy(p.z) }; }
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "triangle_setup.h"
+
+#include "../math/rectangle.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace detail
+{
+
+/*
+ * Screen space tile grid for sort-middle rasterization
+ * -> each tile holds the ids of all triangles overlapping it, in submission order
+ * -> tiles never share pixels, so they can be rasterized independently
+ * -> the grid is aligned to multiples of tile_size, so tiles also never share blocks of the depth hierarchy
+*/
+struct TileGrid
+{
+    static constexpr int tile_size = 64;
+
+    void reset(const Rectf& viewport)
+    {
+        m_area = Recti(viewport.min.x, viewport.min.y, static_cast<int>(viewport.max.x) - 1, static_cast<int>(viewport.max.y) - 1);
+        m_origin = Vec2i(floor_div(m_area.min.x) * tile_size, floor_div(m_area.min.y) * tile_size);
+        m_tiles_x = std::max(0, floor_div(m_area.max.x - m_origin.x) + 1);
+        m_tiles_y = std::max(0, floor_div(m_area.max.y - m_origin.y) + 1);
+
+        /* keep allocated bins around for subsequent draws */
+        if(m_bins.size() < static_cast<std::size_t>(m_tiles_x * m_tiles_y))
+        {
+            m_bins.resize(m_tiles_x * m_tiles_y);
+        }
+
+        for(auto& bin : m_bins)
+        {
+            bin.clear();
+        }
+    }
+
+    void insert(unsigned int id, const TriangleSetup& tri)
+    {
+        Recti bbox = tri.bbox;
+        bbox.clamp(m_area);
+        if(bbox.min.x > bbox.max.x || bbox.min.y > bbox.max.y) return;
+
+        int tx_min = (bbox.min.x - m_origin.x) / tile_size;
+        int ty_min = (bbox.min.y - m_origin.y) / tile_size;
+        int tx_max = (bbox.max.x - m_origin.x) / tile_size;
+        int ty_max = (bbox.max.y - m_origin.y) / tile_size;
+
+        bool single_tile = tx_min == tx_max && ty_min == ty_max;
+
+        for(int ty = ty_min; ty <= ty_max; ty++)
+        {
+            for(int tx = tx_min; tx <= tx_max; tx++)
+            {
+                if(!single_tile && !tri.overlaps(tile(tx, ty))) continue;
+                m_bins[ty * m_tiles_x + tx].push_back(id);
+            }
+        }
+    }
+
+    int size() const { return m_tiles_x * m_tiles_y; }
+
+    const std::vector<unsigned int>& bin(int idx) const { return m_bins[idx]; }
+
+    Recti tile(int idx) const { return tile(idx % m_tiles_x, idx / m_tiles_x); }
+
+    Recti tile(int tx, int ty) const
+    {
+        Recti rect(m_origin.x + tx * tile_size, m_origin.y + ty * tile_size, 0, 0);
+        rect.max = rect.min + Vec2i(tile_size - 1, tile_size - 1);
+        rect.clamp(m_area);
+        return rect;
+    }
+
+private:
+    static int floor_div(int v)
+    {
+        return (v >= 0 ? v : v - tile_size + 1) / tile_size;
+    }
+
+    Recti m_area = Recti(0, 0, -1, -1);
+    Vec2i m_origin;
+    int m_tiles_x = 0;
+    int m_tiles_y = 0;
+    std::vector<std::vector<unsigned int>> m_bins;
+};
+
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "tuple_helper.h"
+
+#include "../math/vector4.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace detail
+{
+
+/*
+ * Clipping in homogeneous clip space
+ * -> near and far planes are clipped exactly, so the depth of every fragment lies in [0, 1]
+ * -> x and y are only clipped against a guard band (multiple of the viewport extent);
+ *    triangles inside of it are left to the rasterizer, which restricts traversal to the viewport anyway
+*/
+inline constexpr float guard_band = 16.0f;
+
+enum eClipPlane : std::uint8_t
+{
+    CLIP_NEAR   = 1 << 0,
+    CLIP_FAR    = 1 << 1,
+    CLIP_LEFT   = 1 << 2,
+    CLIP_RIGHT  = 1 << 3,
+    CLIP_BOTTOM = 1 << 4,
+    CLIP_TOP    = 1 << 5
+};
+
+inline constexpr int num_clip_planes = 6;
+
+/* polygon of a triangle clipped against all planes */
+inline constexpr int max_clip_vertices = 3 + num_clip_planes;
+
+
+/* signed distance to a clip plane (positive inside) */
+inline float clip_distance(const Vec4& p, std::uint8_t plane)
+{
+    switch(plane)
+    {
+    case CLIP_NEAR:   return p.w + p.z;
+    case CLIP_FAR:    return p.w - p.z;
+    case CLIP_LEFT:   return guard_band * p.w + p.x;
+    case CLIP_RIGHT:  return guard_band * p.w - p.x;
+    case CLIP_BOTTOM: return guard_band * p.w + p.y;
+    case CLIP_TOP:    return guard_band * p.w - p.y;
+    default: return 0.0f;
+    }
+}
+
+/* bit mask of all planes the clip space position is outside of */
+inline std::uint8_t outcode(const Vec4& p)
+{
+    std::uint8_t code = 0;
+    for(int i = 0; i < num_clip_planes; i++)
+    {
+        if(clip_distance(p, 1 << i) < 0.0f) code |= 1 << i;
+    }
+
+    return code;
+}
+
+/* linear interpolation of all VARYING members (in clip space) */
+template<typename Varying>
+void clip_interpolate(const Varying& inside, const Varying& outside, float t, Varying& result)
+{
+    auto interpolate = [t](const auto& x0, const auto& x1, auto& res)
+    {
+        res = (1.0f - t) * x0 + t * x1;
+    };
+
+    detail::tuple_iter(interpolate, inside._reflect, outside._reflect, result._reflect);
+}
+
+
+/*
+ * Sutherland-Hodgman clipping of a convex polygon (in clip space) against all planes in mask
+ * -> new vertices are always interpolated from the inside towards the outside vertex,
+ *    so edges shared by two triangles are clipped to the exact same point
+ * -> returns the number of vertices of the clipped polygon (stored in polygon)
+ *
+ * NOTE: Varyings must not be copy constructed (_reflect would reference the members of the source),
+ *       therefore the polygons are default constructed and assigned to
+*/
+template<typename Varying>
+int clip_polygon(std::array<Varying, max_clip_vertices>& polygon, int count, std::uint8_t mask)
+{
+    std::array<Varying, max_clip_vertices> clipped;
+
+    for(int i = 0; i < num_clip_planes && count > 0; i++)
+    {
+        std::uint8_t plane = 1 << i;
+        if(!(mask & plane)) continue;
+
+        int clipped_count = 0;
+        for(int k = 0; k < count; k++)
+        {
+            const Varying& a = polygon[k];
+            const Varying& b = polygon[(k + 1) % count];
+
+            float d_a = clip_distance(a.position, plane);
+            float d_b = clip_distance(b.position, plane);
+
+            if(d_a >= 0.0f)
+            {
+                clipped[clipped_count++] = a;
+            }
+
+            if((d_a >= 0.0f) != (d_b >= 0.0f))
+            {
+                if(d_a >= 0.0f) clip_interpolate(a, b, d_a / (d_a - d_b), clipped[clipped_count++]);
+                else            clip_interpolate(b, a, d_b / (d_b - d_a), clipped[clipped_count++]);
+            }
+        }
+
+        for(int k = 0; k < clipped_count; k++)
+        {
+            polygon[k] = clipped[k];
+        }
+        count = clipped_count;
+    }
+
+    return count;
+}
+
+/* parametric clipping of a line segment; returns false if the segment is completely outside */
+template<typename Varying>
+bool clip_line(Varying& v_0, Varying& v_1, std::uint8_t mask)
+{
+    float t_0 = 0.0f;
+    float t_1 = 1.0f;
+
+    for(int i = 0; i < num_clip_planes; i++)
+    {
+        std::uint8_t plane = 1 << i;
+        if(!(mask & plane)) continue;
+
+        float d_0 = clip_distance(v_0.position, plane);
+        float d_1 = clip_distance(v_1.position, plane);
+
+        if(d_0 < 0.0f && d_1 < 0.0f) return false;
+        if(d_0 < 0.0f) t_0 = std::max(t_0, d_0 / (d_0 - d_1));
+        if(d_1 < 0.0f) t_1 = std::min(t_1, d_0 / (d_0 - d_1));
+    }
+
+    if(t_0 > t_1) return false;
+
+    Varying start, end;
+    clip_interpolate(v_0, v_1, t_0, start);
+    clip_interpolate(v_0, v_1, t_1, end);
+    v_0 = start;
+    v_1 = end;
+
+    return true;
+}
+
+}
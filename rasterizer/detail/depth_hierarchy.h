@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../texture.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace detail
+{
+
+/*
+ * Coarse depth bounds (min/max) of 8x8 pixel blocks of a depth target
+ * -> min is updated on every block the renderer writes to
+ * -> max can only be lowered by writes; blocks are marked dirty and their max is recomputed lazily on the next query
+ * -> depth written by fragment shaders is registered by the renderer, handing out the depth target (Framebuffer::depth()) invalidates it
+*/
+struct DepthHierarchy
+{
+    static constexpr int block_size = 8;
+
+    DepthHierarchy(int width = 0, int height = 0)
+        : m_blocks_x((width + block_size - 1) / block_size),
+          m_blocks_y((height + block_size - 1) / block_size),
+          m_blocks(m_blocks_x * m_blocks_y)
+    {
+        reset(std::numeric_limits<float>::max());
+    }
+
+    void reset(float depth)
+    {
+        std::fill(m_blocks.begin(), m_blocks.end(), Block{ depth, depth, false });
+    }
+
+    void invalidate()
+    {
+        for(auto& block : m_blocks)
+        {
+            block.min = -std::numeric_limits<float>::max();
+            block.dirty = true;
+        }
+    }
+
+    float min(int block_x, int block_y) const
+    {
+        return m_blocks[block_y * m_blocks_x + block_x].min;
+    }
+
+    float max(int block_x, int block_y, const Texture<Depth>& depth)
+    {
+        auto& block = m_blocks[block_y * m_blocks_x + block_x];
+        if(block.dirty)
+        {
+            int x_end = std::min((block_x + 1) * block_size, depth.width());
+            int y_end = std::min((block_y + 1) * block_size, depth.height());
+
+            block.max = -std::numeric_limits<float>::max();
+            for(int y = block_y * block_size; y < y_end; y++)
+            {
+                for(int x = block_x * block_size; x < x_end; x++)
+                {
+                    block.max = std::max(block.max, depth(x, y));
+                }
+            }
+
+            block.dirty = false;
+        }
+
+        return block.max;
+    }
+
+    /* register depth writes to a block; z_min is the smallest depth value written */
+    void update(int block_x, int block_y, float z_min)
+    {
+        auto& block = m_blocks[block_y * m_blocks_x + block_x];
+        block.min = std::min(block.min, z_min);
+        block.dirty = true;
+    }
+
+    int blocks_x() const { return m_blocks_x; }
+    int blocks_y() const { return m_blocks_y; }
+
+private:
+    struct Block
+    {
+        float min;
+        float max;
+        bool dirty;
+    };
+
+    int m_blocks_x;
+    int m_blocks_y;
+    std::vector<Block> m_blocks;
+};
+
+}
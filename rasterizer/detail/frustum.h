@@ -0,0 +1,128 @@
+#pragma once
+
+#include "../buffer.h"
+
+#include "../math/matrix4.h"
+#include "../math/vector3.h"
+#include "../math/vector4.h"
+
+#include <array>
+#include <cmath>
+
+namespace detail
+{
+
+/*
+ * View frustum of a model-view-projection matrix, for culling model space bounds
+ * -> conservative: bounds are only reported outside if they are entirely behind one frustum plane
+ * -> boxes test the sphere first (one dot product per plane), the corners only if the sphere intersects a plane
+ * -> the viewer (null space of the x, y and w rows) is a model space point, or a direction for parallel projections
+*/
+struct Frustum
+{
+    explicit Frustum(const Mat4& mvp)
+    {
+        const std::array<Vec4, 4> rows = {
+            Vec4(mvp(0, 0), mvp(0, 1), mvp(0, 2), mvp(0, 3)),
+            Vec4(mvp(1, 0), mvp(1, 1), mvp(1, 2), mvp(1, 3)),
+            Vec4(mvp(2, 0), mvp(2, 1), mvp(2, 2), mvp(2, 3)),
+            Vec4(mvp(3, 0), mvp(3, 1), mvp(3, 2), mvp(3, 3))
+        };
+
+        /* -w <= x, y, z <= w as model space planes (left, right, bottom, top, near, far) */
+        planes = { rows[3] + rows[0], rows[3] - rows[0],
+                   rows[3] + rows[1], rows[3] - rows[1],
+                   rows[3] + rows[2], rows[3] - rows[2] };
+
+        /* viewer: projects to x = y = w = 0 */
+        auto det3 = [](const Vec3& a, const Vec3& b, const Vec3& c) { return dot(a, cross(b, c)); };
+        const Vec4& r_0 = rows[0];
+        const Vec4& r_1 = rows[1];
+        const Vec4& r_3 = rows[3];
+        Vec4 e( det3(Vec3(r_0.y, r_0.z, r_0.w), Vec3(r_1.y, r_1.z, r_1.w), Vec3(r_3.y, r_3.z, r_3.w)),
+               -det3(Vec3(r_0.x, r_0.z, r_0.w), Vec3(r_1.x, r_1.z, r_1.w), Vec3(r_3.x, r_3.z, r_3.w)),
+                det3(Vec3(r_0.x, r_0.y, r_0.w), Vec3(r_1.x, r_1.y, r_1.w), Vec3(r_3.x, r_3.y, r_3.w)),
+               -det3(Vec3(r_0.x, r_0.y, r_0.z), Vec3(r_1.x, r_1.y, r_1.z), Vec3(r_3.x, r_3.y, r_3.z)));
+
+        Vec3 direction(e.x, e.y, e.z);
+        parallel = std::abs(e.w) <= 1e-6f * length(direction);
+        if(parallel)
+        {
+            /* view direction points towards increasing depth */
+            viewer = normalize(dot(Vec3(rows[2].x, rows[2].y, rows[2].z), direction) < 0.0f ? -direction : direction);
+        }
+        else
+        {
+            viewer = direction / e.w;
+        }
+
+        /* counter-clockwise (front) faces have normals towards the viewer unless the transformation mirrors */
+        float determinant = det3(Vec3(r_0.x, r_0.y, r_0.z), Vec3(r_1.x, r_1.y, r_1.z), Vec3(rows[2].x, rows[2].y, rows[2].z)) * r_3.w
+                          - det3(Vec3(r_0.x, r_0.y, r_0.w), Vec3(r_1.x, r_1.y, r_1.w), Vec3(rows[2].x, rows[2].y, rows[2].w)) * r_3.z
+                          + det3(Vec3(r_0.x, r_0.z, r_0.w), Vec3(r_1.x, r_1.z, r_1.w), Vec3(rows[2].x, rows[2].z, rows[2].w)) * r_3.y
+                          - det3(Vec3(r_0.y, r_0.z, r_0.w), Vec3(r_1.y, r_1.z, r_1.w), Vec3(rows[2].y, rows[2].z, rows[2].w)) * r_3.x;
+        mirrored = determinant > 0.0f;
+    }
+
+    bool outside(const Vec3& center, float radius) const
+    {
+        for(const auto& plane : planes)
+        {
+            if(distance(plane, center) < -radius * length(Vec3(plane.x, plane.y, plane.z))) return true;
+        }
+
+        return false;
+    }
+
+    bool outside(const Bounds& bounds) const
+    {
+        bool intersects = false;
+        for(const auto& plane : planes)
+        {
+            float d = distance(plane, bounds.center);
+            float extent = bounds.radius * length(Vec3(plane.x, plane.y, plane.z));
+
+            if(d < -extent) return true;
+            if(d < extent) intersects = true;
+        }
+
+        if(!intersects) return false;
+
+        for(const auto& plane : planes)
+        {
+            /* box corner furthest along the plane normal */
+            Vec3 corner(plane.x > 0.0f ? bounds.max.x : bounds.min.x,
+                        plane.y > 0.0f ? bounds.max.y : bounds.min.y,
+                        plane.z > 0.0f ? bounds.max.z : bounds.min.z);
+
+            if(distance(plane, corner) < 0.0f) return true;
+        }
+
+        return false;
+    }
+
+    /* true if all triangles within the sphere whose normals lie in the cone face away from the viewer */
+    bool backfacing(const Vec3& center, float radius, const Vec3& cone_axis, float cone_cutoff) const
+    {
+        Vec3 axis = mirrored ? -cone_axis : cone_axis;
+
+        if(parallel) return dot(viewer, axis) >= cone_cutoff;
+
+        Vec3 view = center - viewer;
+        return dot(view, axis) >= cone_cutoff * length(view) + radius;
+    }
+
+    std::array<Vec4, 6> planes;
+
+    Vec3 viewer;
+    bool parallel = false;
+    bool mirrored = false;
+
+private:
+    static float distance(const Vec4& plane, const Vec3& p)
+    {
+        return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+    }
+};
+
+}
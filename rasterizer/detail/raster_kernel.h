@@ -0,0 +1,321 @@
+#pragma once
+
+#include "triangle_setup.h"
+
+#include "../texture.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace detail
+{
+
+/*
+ * Kernels evaluating a row of 8 pixels (x, y) ... (x + 7, y) of a block at once
+ * -> Edges: edge functions of a triangle with the offsets of the lanes, set up once per triangle;
+ *    Row: edge function values of the lanes of a row, next() steps to the row above with one addition per register,
+ *    Row::coverage: lane mask of the pixels inside of all edge functions
+ * -> perspective: w[i] = scale / (w_0 + dw * i), i.e. w of the lanes (scaled) from the plane of 1/w
+ * -> depth_test: early depth test (if test is set) and depth write of the lanes in mask,
+ *    returns the lanes which passed and lowers z_min to the smallest depth written
+ * -> a lane fails the test only if its depth is greater than the buffer: NaN on either side passes in all kernels
+ *    (and NaN depths written are no part of z_min)
+ * -> depth points to the depth value of pixel x; only lanes in 'lanes' (a superset of mask) may be accessed,
+ *    lanes outside of mask are never modified
+*/
+struct RasterKernelScalar
+{
+    static constexpr int width = 8;
+
+    struct Edges
+    {
+        explicit Edges(const std::array<EdgeFunction, 3>& edge) : edge(edge) {}
+
+        const std::array<EdgeFunction, 3>& edge;
+    };
+
+    struct Row
+    {
+        Row(const Edges& edges, int x, int y)
+            : edge(edges.edge), e{ edge[0](x, y), edge[1](x, y), edge[2](x, y) }
+        {
+        }
+
+        unsigned int coverage() const
+        {
+            std::int64_t e_0 = e[0];
+            std::int64_t e_1 = e[1];
+            std::int64_t e_2 = e[2];
+
+            unsigned int mask = 0;
+            for(int i = 0; i < width; i++, e_0 += edge[0].dx, e_1 += edge[1].dx, e_2 += edge[2].dx)
+            {
+                if((e_0 | e_1 | e_2) >= 0) mask |= 1u << i;
+            }
+
+            return mask;
+        }
+
+        void next()
+        {
+            for(int k = 0; k < 3; k++) e[k] += edge[k].dy;
+        }
+
+        const std::array<EdgeFunction, 3>& edge;
+        std::int64_t e[3];
+    };
+
+    static void perspective(float w_0, float dw, float scale, float* w)
+    {
+        for(int i = 0; i < width; i++) w[i] = 1.0f / (w_0 + dw * i) * scale;
+    }
+
+    static unsigned int depth_test(float z_0, float dz, Depth* depth, unsigned int mask, unsigned int lanes, bool test, float& z_min)
+    {
+        for(int i = 0; i < width; i++)
+        {
+            if(mask & (1u << i)) mask &= ~depth_test_lane(i, z_0, dz, depth, test, z_min);
+        }
+
+        return mask;
+    }
+
+    /* returns the bit of lane i if it failed the test */
+    static unsigned int depth_test_lane(int i, float z_0, float dz, Depth* depth, bool test, float& z_min)
+    {
+        float z = z_0 + dz * i;
+        if(test && z > depth[i]) return 1u << i;
+
+        depth[i] = z;
+        z_min = std::min(z_min, z);
+        return 0;
+    }
+};
+
+
+#if defined(__SSE2__) || defined(_M_X64)
+struct RasterKernelSSE2
+{
+    static constexpr int width = 8;
+
+    struct Edges
+    {
+        explicit Edges(const std::array<EdgeFunction, 3>& edge) : edge(edge)
+        {
+            for(int k = 0; k < 3; k++)
+            {
+                for(int j = 0; j < 4; j++) offset[k][j] = _mm_set_epi64x((2*j + 1) * edge[k].dx, 2*j * edge[k].dx);
+                step[k] = _mm_set1_epi64x(edge[k].dy);
+            }
+        }
+
+        const std::array<EdgeFunction, 3>& edge;
+
+        /* 2 x 64 bit lanes per register */
+        __m128i offset[3][4];
+        __m128i step[3];
+    };
+
+    struct Row
+    {
+        Row(const Edges& edges, int x, int y) : edges(edges)
+        {
+            for(int k = 0; k < 3; k++)
+            {
+                __m128i base = _mm_set1_epi64x(edges.edge[k](x, y));
+                for(int j = 0; j < 4; j++) e[k][j] = _mm_add_epi64(base, edges.offset[k][j]);
+            }
+        }
+
+        unsigned int coverage() const
+        {
+            /* the sign bit of (e_0 | e_1 | e_2) marks pixels outside */
+            unsigned int sign = 0;
+            for(int j = 0; j < 4; j++)
+            {
+                __m128i outside = _mm_or_si128(_mm_or_si128(e[0][j], e[1][j]), e[2][j]);
+                sign |= static_cast<unsigned int>(_mm_movemask_pd(_mm_castsi128_pd(outside))) << (2*j);
+            }
+
+            return ~sign & 0xFF;
+        }
+
+        void next()
+        {
+            for(int k = 0; k < 3; k++)
+            {
+                for(int j = 0; j < 4; j++) e[k][j] = _mm_add_epi64(e[k][j], edges.step[k]);
+            }
+        }
+
+        const Edges& edges;
+        __m128i e[3][4];
+    };
+
+    static void perspective(float w_0, float dw, float scale, float* w)
+    {
+        const __m128 lane_index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        for(int h = 0; h < 2; h++)
+        {
+            __m128 inv_w = _mm_add_ps(_mm_set1_ps(w_0), _mm_mul_ps(_mm_set1_ps(dw), _mm_add_ps(lane_index, _mm_set1_ps(4.0f * h))));
+            _mm_storeu_ps(w + 4*h, _mm_mul_ps(_mm_div_ps(_mm_set1_ps(1.0f), inv_w), _mm_set1_ps(scale)));
+        }
+    }
+
+    static unsigned int depth_test(float z_0, float dz, Depth* depth, unsigned int mask, unsigned int lanes, bool test, float& z_min)
+    {
+        const __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+        const __m128 lane_index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+        unsigned int result = 0;
+        for(int h = 0; h < 2; h++)
+        {
+            unsigned int half_mask = (mask >> (4*h)) & 0xF;
+            if(!half_mask) continue;
+
+            /* the block row ends within this half (right border of the framebuffer or the tile) */
+            if(((lanes >> (4*h)) & 0xF) != 0xF)
+            {
+                for(int i = 4*h; i < 4*h + 4; i++)
+                {
+                    if(mask & (1u << i)) result |= (1u << i) & ~RasterKernelScalar::depth_test_lane(i, z_0, dz, depth, test, z_min);
+                }
+                continue;
+            }
+
+            __m128 z = _mm_add_ps(_mm_set1_ps(z_0), _mm_mul_ps(_mm_set1_ps(dz), _mm_add_ps(lane_index, _mm_set1_ps(4.0f * h))));
+            __m128 d = _mm_loadu_ps(depth + 4*h);
+
+            __m128 pass = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(half_mask), lane_bits), lane_bits));
+            if(test) pass = _mm_and_ps(pass, _mm_cmpngt_ps(z, d));
+
+            _mm_storeu_ps(depth + 4*h, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, d)));
+
+            unsigned int passed = _mm_movemask_ps(pass);
+            if(passed)
+            {
+                __m128 written = _mm_and_ps(pass, _mm_cmpord_ps(z, z));
+                __m128 m = _mm_or_ps(_mm_and_ps(written, z), _mm_andnot_ps(written, _mm_set1_ps(std::numeric_limits<float>::max())));
+                m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+                m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+                z_min = std::min(z_min, _mm_cvtss_f32(m));
+            }
+
+            result |= passed << (4*h);
+        }
+
+        return result;
+    }
+};
+#endif
+
+
+#if defined(__AVX2__)
+struct RasterKernelAVX2
+{
+    static constexpr int width = 8;
+
+    struct Edges
+    {
+        explicit Edges(const std::array<EdgeFunction, 3>& edge) : edge(edge)
+        {
+            for(int k = 0; k < 3; k++)
+            {
+                std::int64_t dx = edge[k].dx;
+                offset[k][0] = _mm256_setr_epi64x(0, dx, 2 * dx, 3 * dx);
+                offset[k][1] = _mm256_setr_epi64x(4 * dx, 5 * dx, 6 * dx, 7 * dx);
+                step[k] = _mm256_set1_epi64x(edge[k].dy);
+            }
+        }
+
+        const std::array<EdgeFunction, 3>& edge;
+
+        /* 4 x 64 bit lanes per register */
+        __m256i offset[3][2];
+        __m256i step[3];
+    };
+
+    struct Row
+    {
+        Row(const Edges& edges, int x, int y) : edges(edges)
+        {
+            for(int k = 0; k < 3; k++)
+            {
+                __m256i base = _mm256_set1_epi64x(edges.edge[k](x, y));
+                e[k][0] = _mm256_add_epi64(base, edges.offset[k][0]);
+                e[k][1] = _mm256_add_epi64(base, edges.offset[k][1]);
+            }
+        }
+
+        unsigned int coverage() const
+        {
+            /* the sign bit of (e_0 | e_1 | e_2) marks pixels outside */
+            __m256i outside_lo = _mm256_or_si256(_mm256_or_si256(e[0][0], e[1][0]), e[2][0]);
+            __m256i outside_hi = _mm256_or_si256(_mm256_or_si256(e[0][1], e[1][1]), e[2][1]);
+
+            unsigned int sign = _mm256_movemask_pd(_mm256_castsi256_pd(outside_lo)) | (_mm256_movemask_pd(_mm256_castsi256_pd(outside_hi)) << 4);
+            return ~sign & 0xFF;
+        }
+
+        void next()
+        {
+            for(int k = 0; k < 3; k++)
+            {
+                e[k][0] = _mm256_add_epi64(e[k][0], edges.step[k]);
+                e[k][1] = _mm256_add_epi64(e[k][1], edges.step[k]);
+            }
+        }
+
+        const Edges& edges;
+        __m256i e[3][2];
+    };
+
+    static void perspective(float w_0, float dw, float scale, float* w)
+    {
+        __m256 inv_w = _mm256_add_ps(_mm256_set1_ps(w_0), _mm256_mul_ps(_mm256_set1_ps(dw), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f)));
+        _mm256_storeu_ps(w, _mm256_mul_ps(_mm256_div_ps(_mm256_set1_ps(1.0f), inv_w), _mm256_set1_ps(scale)));
+    }
+
+    static unsigned int depth_test(float z_0, float dz, Depth* depth, unsigned int mask, unsigned int lanes, bool test, float& z_min)
+    {
+        const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+        /* masked loads and stores only touch lanes in mask */
+        __m256i pass = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(mask), lane_bits), lane_bits);
+        __m256 z = _mm256_add_ps(_mm256_set1_ps(z_0), _mm256_mul_ps(_mm256_set1_ps(dz), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f)));
+
+        if(test)
+        {
+            __m256 d = _mm256_maskload_ps(depth, pass);
+            pass = _mm256_and_si256(pass, _mm256_castps_si256(_mm256_cmp_ps(z, d, _CMP_NGT_UQ)));
+        }
+
+        _mm256_maskstore_ps(depth, pass, z);
+
+        unsigned int passed = _mm256_movemask_ps(_mm256_castsi256_ps(pass));
+        if(passed)
+        {
+            __m256 written = _mm256_and_ps(_mm256_castsi256_ps(pass), _mm256_cmp_ps(z, z, _CMP_ORD_Q));
+            __m256 v = _mm256_blendv_ps(_mm256_set1_ps(std::numeric_limits<float>::max()), z, written);
+            __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+            m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+            z_min = std::min(z_min, _mm_cvtss_f32(m));
+        }
+
+        return passed;
+    }
+};
+#endif
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace detail
+{
+
+/*
+ * Typed scratch storage of a renderer (post-transform vertices, clip data, setup data), reused across draws and frames
+ * -> one buffer per type, which only grows; acquiring storage after warm-up neither allocates nor initializes memory
+ * -> objects are default constructed once and keep the contents of their last use
+ * -> buffers are replaced instead of resized, objects are never moved
+ *    (Varyings must not be copied or moved: _reflect references the members of the object it was constructed in)
+ * -> acquired storage stays valid until the next reset()
+*/
+struct ScratchPool
+{
+    /* start of a draw; all storage may be handed out again */
+    void reset()
+    {
+        for(auto& [type, slot] : m_slots)
+        {
+            slot->reset();
+        }
+
+        m_used = 0;
+    }
+
+    template<typename T>
+    std::span<T> acquire(std::size_t count)
+    {
+        auto& slot = m_slots[std::type_index(typeid(T))];
+        if(!slot) slot = std::make_unique<Slot<T>>();
+
+        auto& typed = static_cast<Slot<T>&>(*slot);
+        if(typed.used + count > typed.storage.size())
+        {
+            std::size_t previous = typed.storage.size();
+            std::size_t size = std::max(count, previous * 2);
+            m_capacity += (size - previous) * sizeof(T);
+
+            /* storage handed out since the last reset has to stay valid until then */
+            if(typed.used > 0) typed.retired.push_back(std::move(typed.storage));
+
+            typed.storage = std::vector<T>();
+            typed.storage = std::vector<T>(size);
+            typed.used = 0;
+        }
+
+        std::span<T> result(typed.storage.data() + typed.used, count);
+        typed.used += count;
+
+        track(count * sizeof(T));
+        return result;
+    }
+
+    /* account for scratch memory held outside of the pool (e.g. reused containers) */
+    void track(std::size_t bytes)
+    {
+        m_used += bytes;
+        m_peak = std::max(m_peak, m_used);
+    }
+
+    /* largest amount of scratch memory used by a draw since construction or reset_peak() */
+    std::size_t peak_bytes() const { return m_peak; }
+    void reset_peak() { m_peak = m_used; }
+
+    /* memory held by the pool for reuse */
+    std::size_t capacity_bytes() const { return m_capacity; }
+
+private:
+    struct SlotBase
+    {
+        virtual ~SlotBase() = default;
+        virtual void reset() = 0;
+    };
+
+    template<typename T>
+    struct Slot : SlotBase
+    {
+        std::vector<T> storage;
+        std::size_t used = 0;
+
+        /* buffers outgrown since the last reset */
+        std::vector<std::vector<T>> retired;
+
+        void reset() override
+        {
+            used = 0;
+            retired.clear();
+        }
+    };
+
+    std::unordered_map<std::type_index, std::unique_ptr<SlotBase>> m_slots;
+
+    std::size_t m_used = 0;
+    std::size_t m_peak = 0;
+    std::size_t m_capacity = 0;
+};
+
+}
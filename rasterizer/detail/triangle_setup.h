@@ -0,0 +1,201 @@
+#pragma once
+
+#include "../math/vector2.h"
+#include "../math/vector4.h"
+#include "../math/rectangle.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace detail
+{
+
+/* screen space plane equation f(x, y) = dx * x + dy * y + c */
+struct Plane
+{
+    float dx = 0.0f;
+    float dy = 0.0f;
+    float c = 0.0f;
+
+    float operator()(float x, float y) const
+    {
+        return dx * x + dy * y + c;
+    }
+};
+
+/* integer edge function, evaluated at the center of pixel (x, y); dx and dy are the steps to the next pixel */
+struct EdgeFunction
+{
+    std::int64_t dx = 0;
+    std::int64_t dy = 0;
+    std::int64_t c = 0;
+
+    std::int64_t operator()(int x, int y) const
+    {
+        return dx * x + dy * y + c;
+    }
+};
+
+
+/* outcome of the triangle setup; only accepted triangles are rasterized */
+enum class eSetupResult : std::uint8_t
+{
+    ACCEPTED,
+    BACKFACING,     /* winding culled by face culling */
+    DEGENERATE,     /* zero area after snapping (or invalid coordinates) */
+    NO_COVERAGE     /* covers no pixel center */
+};
+
+
+/*
+ * Per triangle setup of the rasterization stage
+ * -> vertex positions are snapped to 24.8 fixed point, edge functions are evaluated exactly in integers
+ * -> top-left fill rule: pixel centers on an edge belong to the triangle only for top and left edges,
+ *    so pixels on edges shared by two triangles are rasterized exactly once
+ * -> edge functions are scaled by 2 * area, i.e. edge[i] * bc_scale yields the (screen space) barycentric coordinates
+ * -> depth and 1/w are linear in screen space and set up as planes, so traversal only needs additions per pixel
+ * -> planes are relative to the first vertex (origin) to avoid cancellation for large screen coordinates
+ * -> rejections are decided in order of cost: signed area (winding, zero area), bounds, coverage of tiny triangles;
+ *    the floating point planes are only set up for triangles that reach rasterization
+*/
+struct TriangleSetup
+{
+    static constexpr int subpixel_bits = 8;
+    static constexpr std::int64_t subpixel_scale = 1 << subpixel_bits;
+
+    /* larger coordinates (in pixels) are rejected; keeps all edge function values within 64 bit */
+    static constexpr float max_coordinate = float(1 << 20);
+
+    /* triangles with bounds of at most this many pixel centers are tested for coverage during setup */
+    static constexpr std::int64_t small_bbox_pixels = 4;
+
+    std::array<EdgeFunction, 3> edge;
+    float bc_scale = 0.0f;
+    Plane depth;
+    Plane inv_w;
+    Vec2 origin;
+    Recti bbox = Recti(0, 0, -1, -1);
+    float z_min = 0.0f;
+    float z_max = 0.0f;
+
+    /*
+     * expects vertex positions after perspective divide and viewport mapping (w holds 1/w)
+     * -> cull: sign of the signed area of culled triangles (-1 clockwise, 1 counter-clockwise, 0 no culling)
+    */
+    eSetupResult setup(const Vec4& p_0, const Vec4& p_1, const Vec4& p_2, int cull)
+    {
+        /* also rejects NaN */
+        for(const Vec4* p : { &p_0, &p_1, &p_2 })
+        {
+            if(!(std::abs(p->x) < max_coordinate && std::abs(p->y) < max_coordinate)) return eSetupResult::DEGENERATE;
+        }
+
+        const std::array<std::int64_t, 3> x = { snap(p_0.x), snap(p_1.x), snap(p_2.x) };
+        const std::array<std::int64_t, 3> y = { snap(p_0.y), snap(p_1.y), snap(p_2.y) };
+
+        /* signed double area; negative for clockwise triangles */
+        std::int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if(area == 0) return eSetupResult::DEGENERATE;
+        if(cull != 0 && (area < 0) == (cull < 0)) return eSetupResult::BACKFACING;
+
+        /* pixels whose center (x + 0.5, y + 0.5) lies within the bounds of the vertices */
+        constexpr std::int64_t half = subpixel_scale / 2;
+        bbox = Recti(static_cast<int>((std::min({ x[0], x[1], x[2] }) - half + subpixel_scale - 1) >> subpixel_bits),
+                     static_cast<int>((std::min({ y[0], y[1], y[2] }) - half + subpixel_scale - 1) >> subpixel_bits),
+                     static_cast<int>((std::max({ x[0], x[1], x[2] }) - half) >> subpixel_bits),
+                     static_cast<int>((std::max({ y[0], y[1], y[2] }) - half) >> subpixel_bits));
+        if(bbox.min.x > bbox.max.x || bbox.min.y > bbox.max.y) return eSetupResult::NO_COVERAGE;
+
+        /* orient all edge functions positive inside */
+        std::int64_t sign = area < 0 ? -1 : 1;
+        area *= sign;
+
+        for(int i = 0; i < 3; i++)
+        {
+            int a = (i + 1) % 3;
+            int b = (i + 2) % 3;
+
+            std::int64_t dx = (y[a] - y[b]) * sign;
+            std::int64_t dy = (x[b] - x[a]) * sign;
+
+            /* top-left rule (y pointing up): left edges have the inside towards +x, top edges towards -y */
+            bool top_left = dx > 0 || (dx == 0 && dy < 0);
+
+            edge[i].dx = dx * subpixel_scale;
+            edge[i].dy = dy * subpixel_scale;
+            edge[i].c = dx * (half - x[a]) + dy * (half - y[a]) - (top_left ? 0 : 1);
+        }
+
+        if(std::int64_t(bbox.max.x - bbox.min.x + 1) * (bbox.max.y - bbox.min.y + 1) <= small_bbox_pixels && !covers_pixel(bbox))
+        {
+            return eSetupResult::NO_COVERAGE;
+        }
+
+        bc_scale = 1.0f / static_cast<float>(area);
+        origin = Vec2(static_cast<float>(x[0]) / subpixel_scale, static_cast<float>(y[0]) / subpixel_scale);
+
+        /* depth is mapped from [-1, 1] to [0, 1] */
+        depth = interpolation_plane(p_0.z * 0.5f + 0.5f, p_1.z * 0.5f + 0.5f, p_2.z * 0.5f + 0.5f);
+        inv_w = interpolation_plane(p_0.w, p_1.w, p_2.w);
+
+        z_min = std::min({ p_0.z, p_1.z, p_2.z }) * 0.5f + 0.5f;
+        z_max = std::max({ p_0.z, p_1.z, p_2.z }) * 0.5f + 0.5f;
+        return eSetupResult::ACCEPTED;
+    }
+
+    /* exact test: true if a pixel center of rect lies inside of all edges */
+    bool covers_pixel(const Recti& rect) const
+    {
+        for(int y = rect.min.y; y <= rect.max.y; y++)
+        {
+            for(int x = rect.min.x; x <= rect.max.x; x++)
+            {
+                if((edge[0](x, y) | edge[1](x, y) | edge[2](x, y)) >= 0) return true;
+            }
+        }
+
+        return false;
+    }
+
+    /* conservative test: false if all pixel centers of rect lie outside of one edge */
+    bool overlaps(const Recti& rect) const
+    {
+        for(const auto& e : edge)
+        {
+            int x = e.dx > 0 ? rect.max.x : rect.min.x;
+            int y = e.dy > 0 ? rect.max.y : rect.min.y;
+            if(e(x, y) < 0) return false;
+        }
+
+        return true;
+    }
+
+    /* conservative depth range of the triangle over the pixel centers of rect */
+    Vec2 depth_bounds(const Recti& rect) const
+    {
+        float x_lo = (depth.dx > 0.0f ? rect.min.x : rect.max.x) + 0.5f - origin.x;
+        float y_lo = (depth.dy > 0.0f ? rect.min.y : rect.max.y) + 0.5f - origin.y;
+        float x_hi = (depth.dx > 0.0f ? rect.max.x : rect.min.x) + 0.5f - origin.x;
+        float y_hi = (depth.dy > 0.0f ? rect.max.y : rect.min.y) + 0.5f - origin.y;
+
+        return { std::max(z_min, depth(x_lo, y_lo)), std::min(z_max, depth(x_hi, y_hi)) };
+    }
+
+private:
+    static std::int64_t snap(float v)
+    {
+        return static_cast<std::int64_t>(std::lround(v * subpixel_scale));
+    }
+
+    /* plane through the values at the (snapped) vertices, relative to origin */
+    Plane interpolation_plane(float v_0, float v_1, float v_2) const
+    {
+        return { (v_0 * edge[0].dx + v_1 * edge[1].dx + v_2 * edge[2].dx) * bc_scale,
+                 (v_0 * edge[0].dy + v_1 * edge[1].dy + v_2 * edge[2].dy) * bc_scale,
+                 v_0 };
+    }
+};
+
+}
@@ -35,6 +35,19 @@ void tuple_iter(const Func& func, const T& v0, const T& v1, T& res)
 }
 
 
+template <typename T, typename Func, std::size_t... Is>
+void tuple_iter_impl(const Func& func, const T& v0, const T& v1, const T& v2, std::index_sequence<Is...>)
+{
+    (func(std::get<Is>(v0), std::get<Is>(v1), std::get<Is>(v2)), ...);
+}
+
+template <typename T, typename Func, std::size_t Size = std::tuple_size_v<T>>
+void tuple_iter(const Func& func, const T& v0, const T& v1, const T& v2)
+{
+    tuple_iter_impl(func, v0, v1, v2, std::make_index_sequence<Size>{});
+}
+
+
 template <typename T, typename Func, std::size_t... Is>
 void tuple_iter_impl(const Func& func, T& value, std::index_sequence<Is...>)
 {
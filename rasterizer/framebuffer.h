@@ -3,6 +3,7 @@
 #include "texture.h"
 #include "math/vector4.h"
 #include "detail/tuple_helper.h"
+#include "detail/depth_hierarchy.h"
 
 #include <tuple>
 
@@ -20,7 +21,8 @@ struct Framebuffer
 
 
     Framebuffer(unsigned int width, unsigned int height)
-        : m_width(width), m_height(height), m_targets(Texture<Targets>(width, height)...)
+        : m_width(width), m_height(height), m_targets(Texture<Targets>(width, height)...),
+          m_depth_hierarchy(has_depth ? width : 0, has_depth ? height : 0)
     {
 
     }
@@ -46,11 +48,24 @@ struct Framebuffer
         return std::get< detail::tuple_index<Texture<RGBA8>, TargetStorage>::index >(m_targets);
     }
 
+    /* the depth hierarchy can't track writes through the returned texture, it is invalidated */
     template<typename T = Texture<Depth>, typename = HasTarget<T>> Texture<Depth>& depth()
+    {
+        m_depth_hierarchy.invalidate();
+        return depth_target();
+    }
+
+    template<typename T = Texture<Depth>, typename = HasTarget<T>> const Texture<Depth>& depth() const
     {
         return std::get< detail::tuple_index<Texture<Depth>, TargetStorage>::index >(m_targets);
     }
 
+    /* coarse min/max depth per block, maintained by the renderer for early rejection */
+    template<typename T = Texture<Depth>, typename = HasTarget<T>> detail::DepthHierarchy& depth_hierarchy()
+    {
+        return m_depth_hierarchy;
+    }
+
     void clear(const RGBA8& color)
     {
         detail::tuple_iter([color](auto& target)
@@ -66,6 +81,8 @@ struct Framebuffer
             }
 
         }, m_targets);
+
+        m_depth_hierarchy.reset(std::numeric_limits<float>::max());
     }
 
     void clear(const Vec4& color)
@@ -79,9 +96,18 @@ struct Framebuffer
     }
 
 private:
+    friend struct Renderer;
+
+    /* depth target for the renderer, which keeps the depth hierarchy up to date itself */
+    Texture<Depth>& depth_target()
+    {
+        return std::get< detail::tuple_index<Texture<Depth>, TargetStorage>::index >(m_targets);
+    }
+
     int m_width;
     int m_height;
     TargetStorage m_targets;
+    detail::DepthHierarchy m_depth_hierarchy;
 };
 
 using DefaultFramebuffer = Framebuffer<RGBA8, Depth>;
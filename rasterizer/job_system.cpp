@@ -0,0 +1,235 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace
+{
+    thread_local const JobSystem* current_system = nullptr;
+    thread_local unsigned int current_worker = 0;
+
+    void pin_to_core(std::thread& thread, unsigned int core)
+    {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &set);
+#elif defined(_WIN32)
+        SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+#else
+        (void) thread; (void) core;
+#endif
+    }
+}
+
+JobSystem::JobSystem(unsigned int num_threads, bool pin_threads)
+{
+    num_threads = std::max(1u, num_threads);
+
+    m_queues.reserve(num_threads);
+    for(unsigned int i = 0; i < num_threads; i++)
+    {
+        m_queues.emplace_back(std::make_unique<WorkQueue>());
+    }
+
+    m_workers.reserve(num_threads - 1);
+    for(unsigned int i = 1; i < num_threads; i++)
+    {
+        m_workers.emplace_back(&JobSystem::worker_loop, this, i);
+    }
+
+    if(pin_threads) this->pin_threads();
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock(m_sleep_mutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+    for(auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+unsigned int JobSystem::size() const
+{
+    return m_queues.size();
+}
+
+void JobSystem::pin_threads()
+{
+    if(m_pinned.exchange(true)) return;
+
+    unsigned int num_cores = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned int i = 0; i < m_workers.size(); i++)
+    {
+        pin_to_core(m_workers[i], (i + 1) % num_cores);
+    }
+}
+
+void JobSystem::submit(JobGroup& group, Job job)
+{
+    group.pending++;
+
+    /* workers keep their jobs local, other threads distribute round robin */
+    unsigned int slot = current_slot();
+    if(slot == 0)
+    {
+        slot = m_next_slot.fetch_add(1) % m_queues.size();
+    }
+
+    push(slot, Task{ std::move(job), &group });
+}
+
+void JobSystem::wait(JobGroup& group)
+{
+    unsigned int slot = current_slot();
+
+    while(group.pending > 0)
+    {
+        Task task;
+        if(find_task(slot, task))
+        {
+            execute(task);
+            continue;
+        }
+
+        /* remaining jobs are running on other threads; time out to pick up jobs they submit */
+        std::unique_lock lock(m_done_mutex);
+        m_done.wait_for(lock, std::chrono::microseconds(100), [&group]{ return group.pending == 0; });
+    }
+
+    std::exception_ptr exception;
+    {
+        std::lock_guard lock(group.mutex);
+        std::swap(exception, group.exception);
+    }
+
+    if(exception) std::rethrow_exception(exception);
+}
+
+void JobSystem::parallel_for(std::size_t count, std::size_t grain, const RangeFunction& func)
+{
+    if(count == 0) return;
+    grain = std::max<std::size_t>(1, grain);
+
+    if(m_workers.empty() || count <= grain)
+    {
+        func(0, count);
+        return;
+    }
+
+    JobGroup group;
+    for(std::size_t begin = 0; begin < count; begin += grain)
+    {
+        std::size_t end = std::min(begin + grain, count);
+        submit(group, [&func, begin, end]{ func(begin, end); });
+    }
+
+    wait(group);
+}
+
+void JobSystem::worker_loop(unsigned int index)
+{
+    current_system = this;
+    current_worker = index;
+
+    while(true)
+    {
+        Task task;
+        if(find_task(index, task))
+        {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock lock(m_sleep_mutex);
+        m_wake.wait(lock, [this]{ return m_stop || m_queued > 0; });
+        if(m_stop) return;
+    }
+}
+
+void JobSystem::push(unsigned int index, Task&& task)
+{
+    {
+        /* counted before the task can be popped */
+        std::lock_guard lock(m_queues[index]->mutex);
+        m_queued++;
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+
+    {
+        std::lock_guard lock(m_sleep_mutex);
+    }
+    m_wake.notify_one();
+}
+
+bool JobSystem::find_task(unsigned int index, Task& task)
+{
+    /* own queue first (most recently pushed job) */
+    {
+        auto& queue = *m_queues[index];
+        std::lock_guard lock(queue.mutex);
+        if(!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            m_queued--;
+            return true;
+        }
+    }
+
+    /* steal oldest job of another queue */
+    for(unsigned int i = 1; i < m_queues.size(); i++)
+    {
+        auto& queue = *m_queues[(index + i) % m_queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if(!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::execute(Task& task)
+{
+    /* the group has to be released even if the job throws, its waiting thread rethrows */
+    try
+    {
+        task.job();
+    }
+    catch(...)
+    {
+        std::lock_guard lock(task.group->mutex);
+        if(!task.group->exception) task.group->exception = std::current_exception();
+    }
+
+    if(--task.group->pending == 0)
+    {
+        std::lock_guard lock(m_done_mutex);
+        m_done.notify_all();
+    }
+}
+
+unsigned int JobSystem::current_slot()
+{
+    return current_system == this ? current_worker : 0;
+}
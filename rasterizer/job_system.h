@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * counter of outstanding jobs, used to wait for a set of submitted jobs
+ * -> the first exception thrown by a job of the group is rethrown by JobSystem::wait
+*/
+struct JobGroup
+{
+    std::atomic<unsigned int> pending = 0;
+
+    std::mutex mutex;
+    std::exception_ptr exception;
+};
+
+/*
+ * Work-stealing job system with persistent worker threads
+ * -> every worker owns a deque: it pushes/pops jobs at the back, idle workers steal from the front of others
+ * -> threads waiting on a group execute pending jobs, so jobs may submit (and wait on) jobs themselves
+ * -> slot 0 belongs to threads outside of the pool (e.g. the application thread calling Renderer::draw)
+ * -> workers are not pinned to cores unless requested: pools of several renderers (or other processes) would compete for the same cores
+*/
+struct JobSystem
+{
+    using Job = std::function< void () >;
+    using RangeFunction = std::function< void (std::size_t begin, std::size_t end) >;
+
+    explicit JobSystem(unsigned int num_threads = std::thread::hardware_concurrency(), bool pin_threads = false);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /* number of threads executing jobs (workers and the waiting thread) */
+    unsigned int size() const;
+
+    /* pins worker i to core i (modulo the number of cores), once for the lifetime of the pool */
+    void pin_threads();
+
+    void submit(JobGroup& group, Job job);
+
+    /* blocks until all jobs of group are done; rethrows the first exception of its jobs */
+    void wait(JobGroup& group);
+
+    /* splits [0, count) into chunks of size grain and blocks until all chunks are processed */
+    void parallel_for(std::size_t count, std::size_t grain, const RangeFunction& func);
+
+private:
+    struct Task
+    {
+        Job job;
+        JobGroup* group = nullptr;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void worker_loop(unsigned int index);
+    void push(unsigned int index, Task&& task);
+    bool find_task(unsigned int index, Task& task);
+    void execute(Task& task);
+    unsigned int current_slot();
+
+private:
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+
+    std::atomic<unsigned int> m_queued = 0;
+    std::atomic<unsigned int> m_next_slot = 0;
+    std::atomic<bool> m_pinned = false;
+
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    std::mutex m_done_mutex;
+    std::condition_variable m_done;
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+#include "vector2.h"
+#include "vector3.h"
+#include "vector4.h"
+#include "matrix3.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <span>
+
+/* lanes of a packet, one float per AVX2 register */
+inline constexpr std::size_t packet_size = 8;
+
+/*
+ * N floats processed lane-wise; as component type of the vector and matrix types it forms SoA packets
+ * (e.g. Vector4<Packet<N>>: x, y, z and w of N vectors), so Mat4 * Vec4Packet transforms N vectors at once
+ * -> arithmetic operators are plain loops over the lanes, which the compiler vectorizes
+ * -> arithmetic operators and the functions below are lane-wise (e.g. dot, length and normalize of Vec3Packet yield packets),
+ *    other functions of the vector types (with float results) are not supported
+*/
+template<std::size_t N = packet_size>
+struct Packet
+{
+    alignas(sizeof(float) * N) float v[N];
+
+    /* lanes are left uninitialized */
+    Packet() = default;
+
+    Packet(float s)
+    {
+        std::fill(v, v + N, s);
+    }
+
+    float& operator [](std::size_t i)
+    {
+        assert(i < N);
+        return v[i];
+    }
+
+    const float& operator [](std::size_t i) const
+    {
+        assert(i < N);
+        return v[i];
+    }
+
+    Packet operator -() const
+    {
+        Packet r;
+        for(std::size_t i = 0; i < N; i++) r.v[i] = -v[i];
+        return r;
+    }
+
+    Packet& operator +=(const Packet& p) { for(std::size_t i = 0; i < N; i++) v[i] += p.v[i]; return *this; }
+    Packet& operator -=(const Packet& p) { for(std::size_t i = 0; i < N; i++) v[i] -= p.v[i]; return *this; }
+    Packet& operator *=(const Packet& p) { for(std::size_t i = 0; i < N; i++) v[i] *= p.v[i]; return *this; }
+    Packet& operator /=(const Packet& p) { for(std::size_t i = 0; i < N; i++) v[i] /= p.v[i]; return *this; }
+};
+
+template<std::size_t N>
+Packet<N> operator +(Packet<N> a, const Packet<N>& b) { return a += b; }
+
+template<std::size_t N>
+Packet<N> operator -(Packet<N> a, const Packet<N>& b) { return a -= b; }
+
+template<std::size_t N>
+Packet<N> operator *(Packet<N> a, const Packet<N>& b) { return a *= b; }
+
+template<std::size_t N>
+Packet<N> operator /(Packet<N> a, const Packet<N>& b) { return a /= b; }
+
+template<std::size_t N>
+Packet<N> operator +(Packet<N> a, float s) { return a += Packet<N>(s); }
+
+template<std::size_t N>
+Packet<N> operator -(Packet<N> a, float s) { return a -= Packet<N>(s); }
+
+template<std::size_t N>
+Packet<N> operator *(Packet<N> a, float s) { return a *= Packet<N>(s); }
+
+template<std::size_t N>
+Packet<N> operator /(Packet<N> a, float s) { return a /= Packet<N>(s); }
+
+template<std::size_t N>
+Packet<N> operator +(float s, const Packet<N>& a) { return Packet<N>(s) += a; }
+
+template<std::size_t N>
+Packet<N> operator -(float s, const Packet<N>& a) { return Packet<N>(s) -= a; }
+
+template<std::size_t N>
+Packet<N> operator *(float s, const Packet<N>& a) { return Packet<N>(s) *= a; }
+
+template<std::size_t N>
+Packet<N> operator /(float s, const Packet<N>& a) { return Packet<N>(s) /= a; }
+
+/* lane-wise functions (as the scalar functions used in shaders) */
+template<std::size_t N>
+Packet<N> sqrt(const Packet<N>& a)
+{
+    Packet<N> r;
+    for(std::size_t i = 0; i < N; i++) r.v[i] = std::sqrt(a.v[i]);
+    return r;
+}
+
+template<std::size_t N>
+Packet<N> pow(const Packet<N>& a, float e)
+{
+    Packet<N> r;
+    for(std::size_t i = 0; i < N; i++) r.v[i] = std::pow(a.v[i], e);
+    return r;
+}
+
+template<std::size_t N>
+Packet<N> min(const Packet<N>& a, const Packet<N>& b)
+{
+    Packet<N> r;
+    for(std::size_t i = 0; i < N; i++) r.v[i] = std::min(a.v[i], b.v[i]);
+    return r;
+}
+
+template<std::size_t N>
+Packet<N> max(const Packet<N>& a, const Packet<N>& b)
+{
+    Packet<N> r;
+    for(std::size_t i = 0; i < N; i++) r.v[i] = std::max(a.v[i], b.v[i]);
+    return r;
+}
+
+template<std::size_t N>
+Packet<N> clamp(const Packet<N>& a, float lo, float hi)
+{
+    return min(max(a, Packet<N>(lo)), Packet<N>(hi));
+}
+
+template<std::size_t N = packet_size>
+using Vec2Packet = Vector2<Packet<N>>;
+
+template<std::size_t N = packet_size>
+using Vec3Packet = Vector3<Packet<N>>;
+
+template<std::size_t N = packet_size>
+using Vec4Packet = Vector4<Packet<N>>;
+
+template<std::size_t N>
+Packet<N> length(const Vec3Packet<N>& v)
+{
+    return sqrt(dot(v, v));
+}
+
+template<std::size_t N>
+Vec3Packet<N> normalize(const Vec3Packet<N>& v)
+{
+    return v * (1.0f / length(v));
+}
+
+template<std::size_t N>
+Vec3Packet<N> min(const Vec3Packet<N>& a, const Vec3Packet<N>& b)
+{
+    return { min(a.x, b.x), min(a.y, b.y), min(a.z, b.z) };
+}
+
+template<std::size_t N>
+Vec3Packet<N> max(const Vec3Packet<N>& a, const Vec3Packet<N>& b)
+{
+    return { max(a.x, b.x), max(a.y, b.y), max(a.z, b.z) };
+}
+
+/* lanes of bc.x * a + bc.y * b + bc.z * c (interpolation with barycentric coordinates bc), component-wise for vectors and matrices */
+template<std::size_t N>
+Packet<N> interpolate(const Vec3Packet<N>& bc, float a, float b, float c)
+{
+    Packet<N> r;
+    for(std::size_t i = 0; i < N; i++) r.v[i] = bc.x.v[i] * a + bc.y.v[i] * b + bc.z.v[i] * c;
+    return r;
+}
+
+template<std::size_t N>
+Vec2Packet<N> interpolate(const Vec3Packet<N>& bc, const Vector2<float>& a, const Vector2<float>& b, const Vector2<float>& c)
+{
+    return { interpolate(bc, a.x, b.x, c.x), interpolate(bc, a.y, b.y, c.y) };
+}
+
+template<std::size_t N>
+Vec3Packet<N> interpolate(const Vec3Packet<N>& bc, const Vector3<float>& a, const Vector3<float>& b, const Vector3<float>& c)
+{
+    return { interpolate(bc, a.x, b.x, c.x), interpolate(bc, a.y, b.y, c.y), interpolate(bc, a.z, b.z, c.z) };
+}
+
+template<std::size_t N>
+Vec4Packet<N> interpolate(const Vec3Packet<N>& bc, const Vector4<float>& a, const Vector4<float>& b, const Vector4<float>& c)
+{
+    return { interpolate(bc, a.x, b.x, c.x), interpolate(bc, a.y, b.y, c.y), interpolate(bc, a.z, b.z, c.z), interpolate(bc, a.w, b.w, c.w) };
+}
+
+template<std::size_t N>
+Matrix3<Packet<N>> interpolate(const Vec3Packet<N>& bc, const Matrix3<float>& a, const Matrix3<float>& b, const Matrix3<float>& c)
+{
+    Matrix3<Packet<N>> r;
+    for(int i = 0; i < 3; i++)
+    {
+        for(int j = 0; j < 3; j++) r(i, j) = interpolate(bc, a(i, j), b(i, j), c(i, j));
+    }
+    return r;
+}
+
+
+/*
+ * Transposes the member of the first (up to N) elements of in to a packet (AoS -> SoA);
+ * lanes beyond in.size() are zero
+*/
+template<std::size_t N = packet_size, typename S>
+Packet<N> load(std::span<const S> in, float S::* member)
+{
+    Packet<N> p(0.0f);
+    for(std::size_t i = 0; i < std::min(N, in.size()); i++) p[i] = in[i].*member;
+    return p;
+}
+
+template<std::size_t N = packet_size, typename S, typename T>
+Vec2Packet<N> load(std::span<const S> in, Vector2<T> S::* member)
+{
+    Vec2Packet<N> p(Packet<N>(0.0f));
+    for(std::size_t i = 0; i < std::min(N, in.size()); i++)
+    {
+        const auto& v = in[i].*member;
+        p.x[i] = v.x; p.y[i] = v.y;
+    }
+    return p;
+}
+
+template<std::size_t N = packet_size, typename S, typename T>
+Vec3Packet<N> load(std::span<const S> in, Vector3<T> S::* member)
+{
+    Vec3Packet<N> p(Packet<N>(0.0f));
+    for(std::size_t i = 0; i < std::min(N, in.size()); i++)
+    {
+        const auto& v = in[i].*member;
+        p.x[i] = v.x; p.y[i] = v.y; p.z[i] = v.z;
+    }
+    return p;
+}
+
+template<std::size_t N = packet_size, typename S, typename T>
+Vec4Packet<N> load(std::span<const S> in, Vector4<T> S::* member)
+{
+    Vec4Packet<N> p(Packet<N>(0.0f));
+    for(std::size_t i = 0; i < std::min(N, in.size()); i++)
+    {
+        const auto& v = in[i].*member;
+        p.x[i] = v.x; p.y[i] = v.y; p.z[i] = v.z; p.w[i] = v.w;
+    }
+    return p;
+}
+
+/* writes the first (up to N) lanes of p to the member of the elements of out (SoA -> AoS) */
+template<std::size_t N, typename S, typename T>
+void store(const Vec2Packet<N>& p, std::span<S> out, Vector2<T> S::* member)
+{
+    for(std::size_t i = 0; i < std::min(N, out.size()); i++)
+    {
+        auto& v = out[i].*member;
+        v.x = p.x[i]; v.y = p.y[i];
+    }
+}
+
+template<std::size_t N, typename S, typename T>
+void store(const Vec3Packet<N>& p, std::span<S> out, Vector3<T> S::* member)
+{
+    for(std::size_t i = 0; i < std::min(N, out.size()); i++)
+    {
+        auto& v = out[i].*member;
+        v.x = p.x[i]; v.y = p.y[i]; v.z = p.z[i];
+    }
+}
+
+template<std::size_t N, typename S, typename T>
+void store(const Vec4Packet<N>& p, std::span<S> out, Vector4<T> S::* member)
+{
+    for(std::size_t i = 0; i < std::min(N, out.size()); i++)
+    {
+        auto& v = out[i].*member;
+        v.x = p.x[i]; v.y = p.y[i]; v.z = p.z[i]; v.w = p.w[i];
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "buffer.h"
+
+#include "math/vector3.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Cluster of neighbouring triangles of an indexed buffer
+ * -> triangles [triangle_offset, triangle_offset + triangle_count) of the index buffer, referencing vertex_count distinct vertices
+ * -> bounding sphere and normal cone in model space; a cluster is back-facing as a whole
+ *    if the viewer lies within the back side of the cone (cone_cutoff is 1 if the cone can never be culled)
+*/
+struct Meshlet
+{
+    std::uint32_t triangle_offset = 0;
+    std::uint32_t triangle_count = 0;
+    std::uint32_t vertex_count = 0;
+
+    Vec3 center;
+    float radius = 0.0f;
+
+    Vec3 cone_axis;
+    float cone_cutoff = 1.0f;
+};
+
+
+/* indexed triangle buffer split into meshlets; draws with a model-view-projection matrix cull whole meshlets */
+template<typename Vert, typename Ind>
+struct BufferMeshlets : public BufferIndexed<Vert, Ind>
+{
+    std::vector<Meshlet> meshlets;
+};
+
+
+/*
+ * Splits the triangles of buffer into meshlets in index order (optimize the index order for locality first)
+ * -> a meshlet is closed as soon as the next triangle would exceed max_vertices or max_triangles
+ * -> requires Vec3 vertex positions; front faces are counter-clockwise
+*/
+template<typename Vert, typename Ind>
+BufferMeshlets<Vert, Ind> build_meshlets(const BufferIndexed<Vert, Ind>& buffer, std::size_t max_vertices = 64, std::size_t max_triangles = 124)
+{
+    BufferMeshlets<Vert, Ind> result;
+    static_cast<BufferIndexed<Vert, Ind>&>(result) = buffer;
+
+    const std::size_t num_triangles = buffer.indices.size() / 3;
+
+    /* meshlet (+1) a vertex was last counted for */
+    std::vector<std::uint32_t> counted(buffer.vertices.size(), 0);
+
+    auto position = [&buffer](Ind i) { return Vec3(buffer.vertices[i].position); };
+
+    auto finish = [&](Meshlet& meshlet)
+    {
+        const Ind* indices = buffer.indices.data() + meshlet.triangle_offset * 3;
+        const std::size_t count = meshlet.triangle_count * 3;
+
+        Vec3 min = position(indices[0]);
+        Vec3 max = min;
+        for(std::size_t i = 1; i < count; i++)
+        {
+            Vec3 p = position(indices[i]);
+            min = Vec3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+            max = Vec3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+        }
+
+        meshlet.center = 0.5f * (min + max);
+        float radius_squared = 0.0f;
+        for(std::size_t i = 0; i < count; i++)
+        {
+            Vec3 d = position(indices[i]) - meshlet.center;
+            radius_squared = std::max(radius_squared, dot(d, d));
+        }
+        meshlet.radius = std::sqrt(radius_squared);
+
+        /* normal cone: axis is the average normal, the cutoff the sine of the half angle between axis and the widest normal */
+        std::vector<Vec3> normals;
+        normals.reserve(meshlet.triangle_count);
+
+        Vec3 axis(0.0f);
+        for(std::size_t t = 0; t < count; t += 3)
+        {
+            Vec3 n = cross(position(indices[t + 1]) - position(indices[t]), position(indices[t + 2]) - position(indices[t]));
+            float l = length(n);
+            if(l <= 0.0f) continue;
+
+            normals.push_back(n / l);
+            axis += normals.back();
+        }
+
+        meshlet.cone_cutoff = 1.0f;
+        if(normals.empty() || length(axis) <= 0.0f) return;
+
+        meshlet.cone_axis = normalize(axis);
+
+        float min_dot = 1.0f;
+        for(const auto& n : normals) min_dot = std::min(min_dot, dot(n, meshlet.cone_axis));
+
+        /* cones of half angle >= 90 degrees contain opposing normals */
+        if(min_dot > 0.0f) meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    };
+
+    Meshlet meshlet;
+    for(std::size_t t = 0; t < num_triangles; t++)
+    {
+        const Ind* triangle = buffer.indices.data() + t * 3;
+
+        std::uint32_t id = static_cast<std::uint32_t>(result.meshlets.size()) + 1;
+        std::size_t added = 0;
+        for(int k = 0; k < 3; k++)
+        {
+            if(counted[triangle[k]] != id && std::find(triangle, triangle + k, triangle[k]) == triangle + k) added++;
+        }
+
+        if(meshlet.triangle_count > 0 && (meshlet.vertex_count + added > max_vertices || meshlet.triangle_count + 1 > max_triangles))
+        {
+            finish(result.meshlets.emplace_back(meshlet));
+            meshlet = Meshlet();
+            meshlet.triangle_offset = static_cast<std::uint32_t>(t);
+
+            id++;
+            added = 0;
+            for(int k = 0; k < 3; k++)
+            {
+                if(std::find(triangle, triangle + k, triangle[k]) == triangle + k) added++;
+            }
+        }
+
+        for(int k = 0; k < 3; k++) counted[triangle[k]] = id;
+
+        meshlet.vertex_count += static_cast<std::uint32_t>(added);
+        meshlet.triangle_count++;
+    }
+
+    if(meshlet.triangle_count > 0) finish(result.meshlets.emplace_back(meshlet));
+
+    return result;
+}
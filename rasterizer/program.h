@@ -3,24 +3,114 @@
 #include "detail/test_member.h"
 
 #include "math/vector4.h"
+#include "math/packet.h"
 
 #include "framebuffer.h"
 
 #include <functional>
+#include <span>
+#include <type_traits>
+#include <utility>
 
-template<typename Vertex, typename Varying, typename Uniforms, typename FrameTargets = DefaultFramebuffer>
+namespace detail
+{
+    /* type-erased shader signatures (default shader types of Program) */
+    template<typename Vertex, typename Varying, typename Uniforms>
+    using VertexShaderFunction = std::function< void (const Uniforms& uniforms, const Vertex& in, Varying& out) >;
+
+    template<typename Varying, typename Uniforms, typename FrameTargets>
+    using FragmentShaderFunction = std::conditional_t<std::is_same_v<DefaultFramebuffer, FrameTargets>,
+    std::function< void (const Uniforms& uniforms, const Varying& in, Vec4& out) >,
+    std::function< void (const Uniforms& uniforms, const Varying& in, typename FrameTargets::TargetFragments& out) >>;
+
+    /* vertex shader processing a span of vertices per call (see batch_shader) */
+    template<typename Shader>
+    struct BatchVertexShader
+    {
+        Shader shader;
+    };
+
+    template<typename Shader>
+    struct is_batch_shader : std::false_type {};
+
+    template<typename Shader>
+    struct is_batch_shader<BatchVertexShader<Shader>> : std::true_type {};
+
+    /* fragment shader processing a packet of fragments per call (see packet_shader) */
+    template<typename Shader>
+    struct PacketFragmentShader
+    {
+        Shader shader;
+    };
+
+    template<typename Shader>
+    struct is_packet_shader : std::false_type {};
+
+    template<typename Shader>
+    struct is_packet_shader<PacketFragmentShader<Shader>> : std::true_type {};
+
+    /* fragment shader interpolating the members of the varyings it reads (see lazy_shader) */
+    template<typename Shader>
+    struct LazyFragmentShader
+    {
+        Shader shader;
+    };
+
+    template<typename Shader>
+    struct is_lazy_shader : std::false_type {};
+
+    template<typename Shader>
+    struct is_lazy_shader<LazyFragmentShader<Shader>> : std::true_type {};
+
+    /* no fragment shader, only depth is written (see depth_only) */
+    struct DepthOnlyShader {};
+
+    template<typename Shader>
+    struct is_depth_only : std::is_same<Shader, DepthOnlyShader> {};
+
+    /* only type-erased shaders can be empty */
+    template<typename Signature>
+    bool is_shader_set(const std::function<Signature>& shader) { return static_cast<bool>(shader); }
+
+    template<typename Shader>
+    bool is_shader_set(const Shader&) { return true; }
+
+    template<typename Shader>
+    bool is_shader_set(const BatchVertexShader<Shader>& shader) { return is_shader_set(shader.shader); }
+
+    template<typename Shader>
+    bool is_shader_set(const PacketFragmentShader<Shader>& shader) { return is_shader_set(shader.shader); }
+
+    template<typename Shader>
+    bool is_shader_set(const LazyFragmentShader<Shader>& shader) { return is_shader_set(shader.shader); }
+}
+
+/*
+ * Shader program of a draw call
+ * -> by default shaders are stored type-erased (std::function) and set with onVertex/onFragment
+ * -> with the shader types as template arguments (see make_program) shader calls are statically dispatched
+ *    and can be inlined into the rasterizer
+*/
+template<typename Vertex, typename Varying, typename Uniforms, typename FrameTargets = DefaultFramebuffer,
+         typename VertexShaderType = detail::VertexShaderFunction<Vertex, Varying, Uniforms>,
+         typename FragmentShaderType = detail::FragmentShaderFunction<Varying, Uniforms, FrameTargets>>
 struct Program
 {
     static_assert (detail::has_member<Varying>::position::value, "Output of Vertex Stage needs Vec4 position!");
     static_assert (detail::has_member<Varying>::_reflect::value, "Output of Vertex Stage needs interpolated positional values. Did you forget to set VARYING(position) macro? ");
+    static_assert (!detail::is_depth_only<FragmentShaderType>::value || FrameTargets::has_depth, "Depth-only programs need a framebuffer with depth!");
 
 
-    using VertexShader = std::function< void (const Uniforms& uniforms, const Vertex& in, Varying& out) >;
+    using VertexShader = VertexShaderType;
+    using FragmentShader = FragmentShaderType;
 
-    using FragmentShader = std::conditional_t<std::is_same_v<DefaultFramebuffer, FrameTargets>,
-    std::function< void (const Uniforms& uniforms, const Varying& in, Vec4& out) >,
-    std::function< void (const Uniforms& uniforms, const Varying& in, typename FrameTargets::TargetFragments& out) >>;
+    Program() = default;
 
+    Program(const VertexShader& vertShader, const FragmentShader& fragShader)
+        : m_vertShader(vertShader), m_fragShader(fragShader)
+    {
+
+    }
 
     void onVertex(const VertexShader& shader) { m_vertShader = shader; }
     void onFragment(const FragmentShader& shader) { m_fragShader = shader; }
@@ -32,4 +122,100 @@ private:
     Uniforms m_uniforms;
 
     friend struct Renderer;
+    friend struct CommandBuffer;
+};
+
+/*
+ * Batched vertex shader: (uniforms, std::span<const Vertex> in, std::span<Varying> out), instanced (uniforms, in, instance, out)
+ * -> the renderer passes runs of consecutive vertices (all of one instance), out[i] is the output of in[i]
+ * -> lets the shader transform whole packets of vertices at once (see math/packet.h: load, Mat4 * Vec4Packet, store)
+*/
+template<typename Shader>
+auto batch_shader(Shader&& shader)
+{
+    return detail::BatchVertexShader<std::decay_t<Shader>>{ std::forward<Shader>(shader) };
+}
+
+/*
+ * Input of lazy fragment shaders: the fragment as barycentric coordinates and the varyings of the triangle
+ * -> members are interpolated when they are loaded (load(in, &Varying::uv)); members that are never loaded cost nothing
+ * -> derivatives of members and of functions of the input: dFdx(in, &Varying::uv), dFdy(in, &Varying::uv) (see dFdx)
+*/
+template<typename Varying>
+struct LazyFragment
+{
+    /* perspective correct barycentric coordinates */
+    Vec3 bc;
+
+    const Varying& v_0;
+    const Varying& v_1;
+    const Varying& v_2;
+};
+
+/* member of the varyings interpolated at the fragment */
+template<typename Varying, typename T>
+T load(const LazyFragment<Varying>& in, T Varying::* member)
+{
+    return in.bc.x * (in.v_0.*member) + in.bc.y * (in.v_1.*member) + in.bc.z * (in.v_2.*member);
+}
+
+/*
+ * Lazy fragment shader: (uniforms, const LazyFragment<Varying>& in, out), out as for fragment shaders (Vec4 or target fragments)
+ * -> for shaders reading only some of the varyings, or some of them only under a condition;
+ *    shaders without loads (e.g. of depth passes) skip interpolation entirely
+*/
+template<typename Shader>
+auto lazy_shader(Shader&& shader)
+{
+    return detail::LazyFragmentShader<std::decay_t<Shader>>{ std::forward<Shader>(shader) };
+}
+
+/*
+ * Input of packet fragment shaders: a packet of two 2x2 pixel quads (lane 4 * row + column, see fragment_packet_width)
+ * -> members of the varyings are interpolated when they are loaded (load(in, &Varying::uv)), for all lanes at once;
+ *    members that are never loaded cost nothing
+*/
+template<typename Varying>
+struct FragmentPacket
+{
+    /* perspective correct barycentric coordinates of the lanes */
+    Vec3Packet<> bc;
+
+    const Varying& v_0;
+    const Varying& v_1;
+    const Varying& v_2;
 };
+
+/* member of the varyings interpolated for all lanes of the packet, e.g. Vec3Packet<> for a Vec3 member */
+template<typename Varying, typename T>
+auto load(const FragmentPacket<Varying>& in, T Varying::* member)
+{
+    return interpolate(in.bc, in.v_0.*member, in.v_1.*member, in.v_2.*member);
+}
+
+/*
+ * Packet fragment shader: (uniforms, const FragmentPacket<Varying>& in, unsigned int mask, Vec4Packet<>& out)
+ * -> mask holds the lanes that passed the depth test; only their outputs are written,
+ *    the other lanes are helper lanes (or copies of them if the packet holds a single quad)
+ * -> lets the shader compute at SIMD width (see math/packet.h: lane-wise math) and take derivatives of any value (dFdx on packets)
+ * -> only for the default framebuffer
+*/
+template<typename Shader>
+auto packet_shader(Shader&& shader)
+{
+    return detail::PacketFragmentShader<std::decay_t<Shader>>{ std::forward<Shader>(shader) };
+}
+
+/*
+ * Fragment shader of depth-only passes (e.g. shadow maps), make_program<..., Framebuffer<Depth>>(vertex_shader, depth_only)
+ * -> fragments are not shaded: the rasterizer only tests coverage and depth and writes the depth of the passing pixels,
+ *    without barycentric coordinates and interpolation of the varyings; other targets of the framebuffer are not written
+*/
+inline constexpr detail::DepthOnlyShader depth_only{};
+
+/* program with statically dispatched shaders (e.g. lambdas) */
+template<typename Vertex, typename Varying, typename Uniforms, typename FrameTargets = DefaultFramebuffer, typename VertexShader, typename FragmentShader>
+auto make_program(VertexShader&& vertShader, FragmentShader&& fragShader)
+{
+    return Program<Vertex, Varying, Uniforms, FrameTargets, std::decay_t<VertexShader>, std::decay_t<FragmentShader>>(std::forward<VertexShader>(vertShader), std::forward<FragmentShader>(fragShader));
+}
@@ -1,8 +1,21 @@
 #include "renderer.h"
+#include "command_buffer.h"
 
-Renderer::Renderer(unsigned int width, unsigned int height)
+#include <algorithm>
+
+Renderer::Renderer(unsigned int width, unsigned int height, unsigned int num_threads)
     : m_framebuffer(width, height),
-      m_options{ {0, 0, static_cast<float>(width), static_cast<float>(height)}, true, false }
+      m_options{ {0, 0, static_cast<float>(width), static_cast<float>(height)}, true, false },
+      m_own_jobs(std::make_unique<JobSystem>(num_threads)),
+      m_jobs(*m_own_jobs)
+{
+    m_framebuffer.clear(RGBA8(0, 0, 0, 0));
+}
+
+Renderer::Renderer(unsigned int width, unsigned int height, JobSystem& jobs)
+    : m_framebuffer(width, height),
+      m_options{ {0, 0, static_cast<float>(width), static_cast<float>(height)}, true, false },
+      m_jobs(jobs)
 {
     m_framebuffer.clear(RGBA8(0, 0, 0, 0));
 }
@@ -16,3 +29,69 @@ Renderer::Options& Renderer::options()
 {
     return m_options;
 }
+
+JobSystem& Renderer::jobs()
+{
+    return m_jobs;
+}
+
+Renderer::Stats Renderer::stats() const
+{
+    Stats stats = m_stats;
+    stats.scratch_peak_bytes = std::max(m_scratch[0].peak_bytes(), m_scratch[1].peak_bytes());
+    stats.scratch_capacity_bytes = m_scratch[0].capacity_bytes() + m_scratch[1].capacity_bytes();
+    return stats;
+}
+
+void Renderer::reset_stats()
+{
+    m_stats = Stats();
+    m_scratch[0].reset_peak();
+    m_scratch[1].reset_peak();
+}
+
+void Renderer::submit(const CommandBuffer& commands)
+{
+    /* draw whose vertex stage runs as a job of groups[current] until it is rasterized; its scratch storage is m_scratch[current] */
+    const CommandBuffer::Command* pending = nullptr;
+    JobGroup groups[2];
+    int current = 0;
+
+    auto finish_pending = [&]()
+    {
+        if(!pending) return;
+
+        m_jobs.wait(groups[current]);
+
+        m_scratch_current = current;
+        pending->rasterize(*this);
+        pending = nullptr;
+    };
+
+    for(const auto& command : commands.m_commands)
+    {
+        if(command.execute)
+        {
+            finish_pending();
+
+            command.execute(*this);
+            continue;
+        }
+
+        /* the other pool was used by the draw before the pending one, which is rasterized, so scratch memory is bounded by two draws */
+        int next = current ^ 1;
+        m_scratch_current = next;
+        scratch().reset();
+
+        if(!command.prepare(*this)) continue;
+
+        /* vertex stage of this draw overlaps with the rasterization of the previous one */
+        m_jobs.submit(groups[next], [this, &command]() { command.shade(*this); });
+
+        finish_pending();
+        pending = &command;
+        current = next;
+    }
+
+    finish_pending();
+}
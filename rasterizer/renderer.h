@@ -1,16 +1,44 @@
 #pragma once
 
 #include "buffer.h"
+#include "meshlet.h"
 #include "program.h"
 #include "framebuffer.h"
+#include "derivatives.h"
 
 #include "math/utility.h"
 #include "math/rectangle.h"
 
 #include "detail/test_member.h"
 #include "detail/tuple_helper.h"
+#include "detail/triangle_setup.h"
+#include "detail/binning.h"
+#include "detail/clipping.h"
+#include "detail/frustum.h"
+#include "detail/raster_kernel.h"
+#include "detail/scratch_pool.h"
 
+#include "job_system.h"
+
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+struct CommandBuffer;
+
+/* winding order of a triangle on screen */
+enum class eWinding
+{
+    CCW,
+    CW
+};
 
 struct Renderer
 {
@@ -20,90 +48,556 @@ struct Renderer
         Rectf viewport;
         bool culling;
         bool wireframe;
+
+        /* sort-middle rasterization: bin triangles to screen tiles and rasterize tiles in parallel */
+        bool binning = true;
+
+        /* triangles removed by face culling (if culling is set); counter-clockwise triangles are front faces by default */
+        eWinding cull_winding = eWinding::CW;
+
+        /* pin the workers of the job system to cores from the first draw on (see JobSystem::pin_threads);
+         * only for a renderer owning the machine, pinned pools of several renderers share the same cores */
+        bool pin_threads = false;
     };
 
 
-    Renderer(unsigned int width, unsigned int height);
+    Renderer(unsigned int width, unsigned int height, unsigned int num_threads = std::thread::hardware_concurrency());
+
+    /* renderer on the job system jobs, which has to outlive it (e.g. one pool shared by all renderers of the process) */
+    Renderer(unsigned int width, unsigned int height, JobSystem& jobs);
 
     DefaultFramebuffer& framebuffer();
     Options& options();
 
+    /* job system used by all pipeline stages; applications may schedule their own passes on it */
+    JobSystem& jobs();
+
+    /* pipeline statistics */
+    struct Stats
+    {
+        /* scratch memory (post-transform vertices, clip and setup data) of the largest draw and held for reuse (by both pools of submit) */
+        std::size_t scratch_peak_bytes = 0;
+        std::size_t scratch_capacity_bytes = 0;
+
+        /* vertex stage: indices referencing a vertex (vertices of non-indexed draws) and vertices shaded;
+         * indexed draws shade each referenced vertex exactly once, all other references hit the post-transform cache */
+        std::size_t vertex_references = 0;
+        std::size_t vertices_shaded = 0;
+
+        /* draws executed and draws skipped by frustum culling */
+        std::size_t draws = 0;
+        std::size_t draws_culled = 0;
+
+        /* meshlets of drawn meshlet buffers, and the ones culled (frustum or normal cone) before the vertex stage */
+        std::size_t meshlets = 0;
+        std::size_t meshlets_culled = 0;
 
+        /* primitive assembly: triangles of draws and the ones entirely outside of a clip plane;
+         * triangles after clipping are either rejected by the setup (face culling, zero area, no pixel center covered) or rasterized */
+        std::size_t triangles = 0;
+        std::size_t triangles_outside = 0;
+        std::size_t triangles_backfacing = 0;
+        std::size_t triangles_degenerate = 0;
+        std::size_t triangles_no_coverage = 0;
+        std::size_t triangles_rasterized = 0;
+
+        /* rasterized triangles by the number n of pixel centers in their bounds: bin k holds 4^(k-1) < n <= 4^k
+         * (1, 2 - 4 (2x2), 5 - 16 (4x4), 17 - 64 (8x8), ...), the last bin all larger ones */
+        std::array<std::size_t, 8> triangle_sizes = {};
+
+        static std::size_t triangle_size_bin(std::int64_t pixels)
+        {
+            return std::min<std::size_t>((std::bit_width(static_cast<std::uint64_t>(pixels - 1)) + 1) / 2, std::tuple_size_v<decltype(triangle_sizes)> - 1);
+        }
+
+        float vertex_cache_hit_rate() const
+        {
+            return vertex_references > 0 ? 1.0f - static_cast<float>(vertices_shaded) / vertex_references : 0.0f;
+        }
+    };
+
+    /* statistics accumulated since construction or the last reset_stats() */
+    Stats stats() const;
+    void reset_stats();
+
+
+
+    /*
+     * Draw with frustum culling: skipped entirely if the bounds of the buffer lie outside of the view frustum of mvp
+     * (the model-view-projection matrix the vertex shader applies); buffers without bounds are always drawn
+     * -> accepts the arguments of all other draw calls, returns false if the draw was culled
+     * -> meshlet buffers additionally cull each meshlet against the frustum and (with face culling) its normal cone,
+     *    only vertices of the remaining meshlets are shaded
+    */
+    template<typename ProgramType, typename BufferType, typename... Args>
+    bool draw(const Mat4& mvp, const ProgramType& program, const BufferType& buffer, Args&&... args)
+    {
+        detail::Frustum frustum(mvp);
+        return draw_culled(&frustum, program, buffer, std::forward<Args>(args)...);
+    }
 
-    template<typename Vertex, typename Varying, typename Uniforms>
-    void draw(const Program<Vertex, Varying, Uniforms>& program, const struct Buffer<Vertex>& buffer)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS>
+    void draw(const Program<Vertex, Varying, Uniforms, DefaultFramebuffer, VS, FS>& program, const struct Buffer<Vertex>& buffer)
     {
         draw(program, buffer, m_framebuffer, m_options);
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename Indx>
-    void draw(const Program<Vertex, Varying, Uniforms>& program, const struct BufferIndexed<Vertex, Indx>& buffer)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Indx>
+    void draw(const Program<Vertex, Varying, Uniforms, DefaultFramebuffer, VS, FS>& program, const struct BufferIndexed<Vertex, Indx>& buffer)
     {
         draw(program, buffer, m_framebuffer, m_options);
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename... Targets>
-    void draw(const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, const struct Buffer<Vertex>& buffer, Framebuffer<Targets...>& fb)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void draw(const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const struct Buffer<Vertex>& buffer, Framebuffer<Targets...>& fb)
     {
         draw(program, buffer, fb, m_options);
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename Indx, typename... Targets>
-    void draw(const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, const struct BufferIndexed<Vertex, Indx>& buffer, Framebuffer<Targets...>& fb)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Indx, typename... Targets>
+    void draw(const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const struct BufferIndexed<Vertex, Indx>& buffer, Framebuffer<Targets...>& fb)
     {
         draw(program, buffer, fb, m_options);
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename... Targets>
-    void draw(const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, const struct Buffer<Vertex>& buffer, Framebuffer<Targets...>& fb, const Options& options)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void draw(const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const struct Buffer<Vertex>& buffer, Framebuffer<Targets...>& fb, const Options& options)
+    {
+        draw_culled(nullptr, program, buffer, fb, options);
+    }
+
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Indx, typename... Targets>
+    void draw(const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const struct BufferIndexed<Vertex, Indx>& buffer, Framebuffer<Targets...>& fb, const Options& options)
+    {
+        draw_culled(nullptr, program, buffer, fb, options);
+    }
+
+    /* executes the recorded commands (see CommandBuffer) */
+    void submit(const CommandBuffer& commands);
+
+
+    /*
+     * Instanced draw: the buffer is drawn once per element of instances (in order), the vertex shader
+     * receives the data of its instance: (uniforms, vertex, instance, out)
+     * -> the vertex stage and rasterization run once for a whole batch of instances,
+     *    so setup is shared and the vertices of all instances are distributed across the threads
+    */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename BufferType, typename Instance>
+    void draw_instanced(const Program<Vertex, Varying, Uniforms, DefaultFramebuffer, VS, FS>& program, const BufferType& buffer, const std::vector<Instance>& instances)
+    {
+        draw_instanced(program, buffer, instances, m_framebuffer, m_options);
+    }
+
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename BufferType, typename Instance, typename... Targets>
+    void draw_instanced(const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const BufferType& buffer, const std::vector<Instance>& instances, Framebuffer<Targets...>& fb)
+    {
+        draw_instanced(program, buffer, instances, fb, m_options);
+    }
+
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename BufferType, typename Instance, typename... Targets>
+    void draw_instanced(const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const BufferType& buffer, const std::vector<Instance>& instances, Framebuffer<Targets...>& fb, const Options& options)
+    {
+        if constexpr (detail::is_batch_shader<VS>::value)
+        {
+            static_assert(std::is_invocable_v<const decltype(VS::shader)&, const Uniforms&, std::span<const Vertex>, const Instance&, std::span<Varying>>,
+                          "Instanced draws need a vertex shader taking the instance data: (uniforms, vertices, instance, out)");
+        }
+        else
+        {
+            static_assert(std::is_invocable_v<const VS&, const Uniforms&, const Vertex&, const Instance&, Varying&>,
+                          "Instanced draws need a vertex shader taking the instance data: (uniforms, vertex, instance, out)");
+        }
+        static_assert(std::is_base_of_v<Buffer<Vertex>, BufferType>, "Buffer has to contain vertices of the program");
+
+        assert(detail::is_shader_set(program.m_vertShader));
+        assert(detail::is_shader_set(program.m_fragShader));
+
+        const std::size_t num_vertices = buffer.vertices.size();
+        if(instances.empty() || num_vertices == 0) return;
+
+        m_stats.draws++;
+
+        const std::size_t batch_size = std::max<std::size_t>(1, instance_batch_vertices / num_vertices);
+        for(std::size_t first = 0; first < instances.size(); first += batch_size)
+        {
+            const std::size_t count = std::min(batch_size, instances.size() - first);
+            std::span<const Instance> batch(instances.data() + first, count);
+
+            scratch().reset();
+
+            std::span<Varying> pipeline_data = scratch().acquire<Varying>(num_vertices * count);
+
+            if constexpr (requires { buffer.indices; })
+            {
+                std::span<const std::uint8_t> referenced = mark_referenced(num_vertices, std::span(buffer.indices), count);
+                process_vertices(buffer.vertices, pipeline_data, program, options, referenced, batch);
+
+                /* indices of the instances of the batch into pipeline_data */
+                std::span<std::uint32_t> indices = scratch().acquire<std::uint32_t>(buffer.indices.size() * count);
+                for(std::size_t k = 0; k < count; k++)
+                {
+                    for(std::size_t i = 0; i < buffer.indices.size(); i++)
+                    {
+                        indices[k * buffer.indices.size() + i] = static_cast<std::uint32_t>(k * num_vertices + buffer.indices[i]);
+                    }
+                }
+
+                draw_primitives(buffer.primitive, std::span<const Varying>(pipeline_data), std::span<const std::uint32_t>(indices), program, fb, options);
+            }
+            else
+            {
+                m_stats.vertex_references += num_vertices * count;
+                m_stats.vertices_shaded += num_vertices * count;
+
+                process_vertices(buffer.vertices, pipeline_data, program, options, {}, batch);
+                draw_primitives(buffer.primitive, std::span<const Varying>(pipeline_data), program, fb, options);
+            }
+        }
+    }
+
+
+private:
+    /* vertices per job of the vertex stage */
+    static constexpr std::size_t vertex_chunk_size = 1024;
+
+    /* vertices of all instances shaded and rasterized in one pass of an instanced draw (bounds the scratch memory) */
+    static constexpr std::size_t instance_batch_vertices = 1 << 16;
+
+    /* triangles per job of primitive assembly and setup */
+    static constexpr std::size_t triangle_chunk_size = 1024;
+
+    /* triangles with at most this many pixel centers per side of their (clamped) bounds take the small triangle path */
+    static constexpr int small_triangle_size = 4;
+
+    /* triangle statistics of primitive assembly and setup, collected per job */
+    struct TriangleCounters
+    {
+        std::size_t triangles = 0;
+        std::size_t outside = 0;
+        std::array<std::size_t, 4> setup = {};
+        decltype(Stats::triangle_sizes) sizes = {};
+
+        /* counts the result of the setup of tri, true if the triangle is rasterized */
+        bool accept(detail::eSetupResult result, const detail::TriangleSetup& tri)
+        {
+            setup[static_cast<std::size_t>(result)]++;
+            if(result != detail::eSetupResult::ACCEPTED) return false;
+
+            sizes[Stats::triangle_size_bin(std::int64_t(tri.bbox.max.x - tri.bbox.min.x + 1) * (tri.bbox.max.y - tri.bbox.min.y + 1))]++;
+            return true;
+        }
+    };
+
+    void add_stats(const TriangleCounters& counters)
+    {
+        m_stats.triangles += counters.triangles;
+        m_stats.triangles_outside += counters.outside;
+        m_stats.triangles_rasterized += counters.setup[static_cast<std::size_t>(detail::eSetupResult::ACCEPTED)];
+        m_stats.triangles_backfacing += counters.setup[static_cast<std::size_t>(detail::eSetupResult::BACKFACING)];
+        m_stats.triangles_degenerate += counters.setup[static_cast<std::size_t>(detail::eSetupResult::DEGENERATE)];
+        m_stats.triangles_no_coverage += counters.setup[static_cast<std::size_t>(detail::eSetupResult::NO_COVERAGE)];
+
+        for(std::size_t k = 0; k < counters.sizes.size(); k++) m_stats.triangle_sizes[k] += counters.sizes[k];
+    }
+
+    /* sign of the signed area of the triangles removed by face culling (0: none) */
+    static int cull_sign(const Options& options)
+    {
+        if(!options.culling) return 0;
+        return options.cull_winding == eWinding::CW ? -1 : 1;
+    }
+
+    /* coverage and depth kernel for rows of 8 pixels, selected by the instruction sets enabled at compile time */
+#if defined(__AVX2__) && !defined(RASTERIZER_NO_SIMD)
+    using RasterKernel = detail::RasterKernelAVX2;
+#elif (defined(__SSE2__) || defined(_M_X64)) && !defined(RASTERIZER_NO_SIMD)
+    using RasterKernel = detail::RasterKernelSSE2;
+#else
+    using RasterKernel = detail::RasterKernelScalar;
+#endif
+    static_assert(RasterKernel::width == detail::DepthHierarchy::block_size && detail::QuadRows::width == detail::DepthHierarchy::block_size);
+
+    /* index type of a buffer; non-indexed buffers use a placeholder */
+    template<typename BufferType, typename = void>
+    struct IndexType { using type = std::uint32_t; };
+
+    template<typename BufferType>
+    struct IndexType<BufferType, std::void_t<decltype(BufferType::indices)>> { using type = typename decltype(BufferType::indices)::value_type; };
+
+    /*
+     * Scratch storage of a draw, set up ahead of its vertex stage
+     * -> a draw runs in three steps: prepare_draw (culling, statistics, scratch storage) on the submitting thread,
+     *    shade_draw (vertex stage, touches nothing but the storage of the draw) and rasterize_draw
+    */
+    template<typename Varying, typename Indx>
+    struct PreparedDraw
+    {
+        std::span<Varying> out;
+        std::span<Vec4> clip_positions;
+        std::span<std::uint8_t> clip_codes;
+
+        /* vertices referenced by indices; empty if all vertices are shaded */
+        std::span<const std::uint8_t> referenced;
+
+        bool indexed = false;
+        std::span<const Indx> indices;
+    };
+
+    template<typename ProgramType, typename BufferType>
+    bool draw_culled(const detail::Frustum* frustum, const ProgramType& program, const BufferType& buffer)
+    {
+        return draw_culled(frustum, program, buffer, m_framebuffer, m_options);
+    }
+
+    template<typename ProgramType, typename BufferType, typename... Targets>
+    bool draw_culled(const detail::Frustum* frustum, const ProgramType& program, const BufferType& buffer, Framebuffer<Targets...>& fb)
+    {
+        return draw_culled(frustum, program, buffer, fb, m_options);
+    }
+
+    /* immediate draw; culled against frustum if given */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename BufferType, typename... Targets>
+    bool draw_culled(const detail::Frustum* frustum, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const BufferType& buffer, Framebuffer<Targets...>& fb, const Options& options)
+    {
+        assert(detail::is_shader_set(program.m_vertShader));
+        assert(detail::is_shader_set(program.m_fragShader));
+
+        scratch().reset();
+
+        auto prepared = prepare_draw<Varying>(buffer, frustum, options);
+        if(!prepared) return false;
+
+        shade_draw(*prepared, program, buffer, options);
+        rasterize_draw(*prepared, program, buffer, fb, options);
+        return true;
+    }
+
+    template<typename Varying, typename BufferType>
+    std::optional<PreparedDraw<Varying, typename IndexType<BufferType>::type>> prepare_draw(const BufferType& buffer, const detail::Frustum* frustum, const Options& options)
     {
-        assert(program.m_vertShader);
-        assert(program.m_fragShader);
+        using Indx = typename IndexType<BufferType>::type;
+
+        if(options.pin_threads) m_jobs.pin_threads();
+
+        if(frustum && buffer.bounds && frustum->outside(*buffer.bounds))
+        {
+            m_stats.draws_culled++;
+            return std::nullopt;
+        }
+
+        m_stats.draws++;
+
+        PreparedDraw<Varying, Indx> draw;
+        if constexpr (requires { buffer.indices; })
+        {
+            draw.indexed = true;
+            draw.indices = buffer.indices;
+
+            if constexpr (requires { buffer.meshlets; })
+            {
+                if(frustum) draw.indices = cull_meshlets(*frustum, buffer, options);
+            }
 
-        std::vector<Varying> pipeline_data(buffer.vertices.size());
-        process_vertices(buffer.vertices, pipeline_data, program, options);
+            /* post-transform cache: only referenced vertices are shaded, each one exactly once */
+            draw.referenced = mark_referenced(buffer.vertices.size(), draw.indices);
+        }
+        else
+        {
+            m_stats.vertex_references += buffer.vertices.size();
+            m_stats.vertices_shaded += buffer.vertices.size();
+        }
+
+        draw.out = scratch().acquire<Varying>(buffer.vertices.size());
+        draw.clip_positions = scratch().acquire<Vec4>(buffer.vertices.size());
+        draw.clip_codes = scratch().acquire<std::uint8_t>(buffer.vertices.size());
+        return draw;
+    }
+
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Indx, typename BufferType, typename... Targets>
+    void shade_draw(const PreparedDraw<Varying, Indx>& draw, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const BufferType& buffer, const Options& options)
+    {
+        shade_vertices(buffer.vertices, draw.out, draw.clip_positions, draw.clip_codes, program, options, draw.referenced);
+    }
+
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Indx, typename BufferType, typename... Targets>
+    void rasterize_draw(const PreparedDraw<Varying, Indx>& draw, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const BufferType& buffer, Framebuffer<Targets...>& fb, const Options& options)
+    {
+        m_clip_positions = draw.clip_positions;
+        m_clip_codes = draw.clip_codes;
+
+        std::span<const Varying> in = draw.out;
+        if(draw.indexed)
+        {
+            draw_primitives(buffer.primitive, in, draw.indices, program, fb, options);
+        }
+        else
+        {
+            draw_primitives(buffer.primitive, in, program, fb, options);
+        }
+    }
 
-        switch(buffer.primitive)
+    /* primitive assembly and rasterization of the processed vertices in */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void draw_primitives(ePrimitive primitive, std::span<const Varying> in, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
+    {
+        switch(primitive)
         {
-        case ePrimitive::TRIANGLES: options.wireframe ? draw_triangles_wireframe(pipeline_data, program, fb, options)
-                                                      : draw_triangles(pipeline_data, program, fb, options);
+        case ePrimitive::TRIANGLES: options.wireframe ? draw_triangles_wireframe(in, program, fb, options)
+                                                      : draw_triangles(in, program, fb, options);
             break;
-        case ePrimitive::LINES: draw_lines(pipeline_data, program, fb, options);
+        case ePrimitive::LINES: draw_lines(in, program, fb, options);
             break;
         default: break;
         }
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename Indx, typename... Targets>
-    void draw(const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, const struct BufferIndexed<Vertex, Indx>& buffer, Framebuffer<Targets...>& fb, const Options& options)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Indx, typename... Targets>
+    void draw_primitives(ePrimitive primitive, std::span<const Varying> in, std::span<const Indx> indices, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
     {
-        assert(program.m_vertShader);
-        assert(program.m_fragShader);
-
-        std::vector<Varying> pipeline_data(buffer.vertices.size());
-        process_vertices(buffer.vertices, pipeline_data, program, options);
-
-        switch(buffer.primitive)
+        switch(primitive)
         {
-        case ePrimitive::TRIANGLES: options.wireframe ? draw_triangles_wireframe(pipeline_data, buffer.indices, program, fb, options)
-                                                      : draw_triangles(pipeline_data, buffer.indices, program, fb, options);
+        case ePrimitive::TRIANGLES: options.wireframe ? draw_triangles_wireframe(in, indices, program, fb, options)
+                                                      : draw_triangles(in, indices, program, fb, options);
             break;
-        case ePrimitive::LINES: draw_lines(pipeline_data, buffer.indices, program, fb, options);
+        case ePrimitive::LINES: draw_lines(in, indices, program, fb, options);
             break;
         default: break;
         }
     }
 
+    /* meshlet culling ahead of the vertex stage; returns the triangles of the remaining meshlets as one index buffer */
+    template<typename Vertex, typename Indx>
+    std::span<const Indx> cull_meshlets(const detail::Frustum& frustum, const BufferMeshlets<Vertex, Indx>& buffer, const Options& options)
+    {
+        /* lines and wireframes are not face culled */
+        const bool cone_culling = options.culling && !options.wireframe && buffer.primitive == ePrimitive::TRIANGLES;
 
-private:
-    template<typename Vertex, typename Varying, typename Uniforms, typename... Targets>
-    void process_vertices(const std::vector<Vertex>& vertices, std::vector<Varying>& out, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, const Options& options)
+        std::span<Indx> indices = scratch().acquire<Indx>(buffer.indices.size());
+        std::size_t count = 0;
+        for(const auto& meshlet : buffer.meshlets)
+        {
+            /* with clockwise triangles culled the cone has to face away from the viewer, otherwise towards it */
+            const Vec3 cone_axis = options.cull_winding == eWinding::CW ? meshlet.cone_axis : -meshlet.cone_axis;
+            if(frustum.outside(meshlet.center, meshlet.radius) ||
+               (cone_culling && frustum.backfacing(meshlet.center, meshlet.radius, cone_axis, meshlet.cone_cutoff)))
+            {
+                m_stats.meshlets_culled++;
+                continue;
+            }
+
+            auto begin = buffer.indices.begin() + meshlet.triangle_offset * 3;
+            std::copy(begin, begin + meshlet.triangle_count * 3, indices.begin() + count);
+            count += meshlet.triangle_count * 3;
+        }
+
+        m_stats.meshlets += buffer.meshlets.size();
+
+        return indices.first(count);
+    }
+
+    /* memo table of the vertices referenced by indices (statistics count all instances) */
+    template<typename Indx>
+    std::span<const std::uint8_t> mark_referenced(std::size_t num_vertices, std::span<const Indx> indices, std::size_t instances = 1)
     {
-        for(unsigned int i = 0; i < vertices.size(); i++)
+        std::span<std::uint8_t> referenced = scratch().acquire<std::uint8_t>(num_vertices);
+        std::fill(referenced.begin(), referenced.end(), 0);
+
+        std::size_t unique = 0;
+        for(Indx i : indices)
         {
-            program.m_vertShader(program.m_uniforms, vertices[i], out[i]);
-            post_process_vertices(out[i], options);
+            unique += referenced[i] ^ 1;
+            referenced[i] = 1;
         }
+
+        m_stats.vertex_references += indices.size() * instances;
+        m_stats.vertices_shaded += unique * instances;
+
+        return referenced;
+    }
+
+    /* vertex stage with clip data in scratch storage of the current draw */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets, typename Instance = std::nullptr_t>
+    void process_vertices(const std::vector<Vertex>& vertices, std::span<Varying> out, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const Options& options, std::span<const std::uint8_t> referenced = {}, std::span<const Instance> instances = {})
+    {
+        m_clip_positions = scratch().acquire<Vec4>(out.size());
+        m_clip_codes = scratch().acquire<std::uint8_t>(out.size());
+
+        shade_vertices(vertices, out, m_clip_positions, m_clip_codes, program, options, referenced, instances);
+    }
+
+    /*
+     * vertex stage; if referenced is given, only vertices marked in it are processed
+     * -> instanced: out holds the vertices of all instances one after another, instance k is passed to the vertex shader of out[k * vertices.size() + i]
+     * -> batched shaders are called once per run of consecutive referenced vertices of one instance within a chunk
+    */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets, typename Instance = std::nullptr_t>
+    void shade_vertices(const std::vector<Vertex>& vertices, std::span<Varying> out, std::span<Vec4> clip_positions, std::span<std::uint8_t> clip_codes, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, const Options& options, std::span<const std::uint8_t> referenced = {}, std::span<const Instance> instances = {})
+    {
+        constexpr bool instanced = !std::is_same_v<Instance, std::nullptr_t>;
+
+        auto finish_vertex = [&](std::size_t i)
+        {
+            /* keep the clip space position for primitives which need to be clipped */
+            clip_positions[i] = out[i].position;
+            clip_codes[i] = detail::outcode(out[i].position);
+
+            post_process_vertices(out[i], options);
+        };
+
+        /* every vertex writes only its own output slot, so the result does not depend on the chunking */
+        m_jobs.parallel_for(out.size(), vertex_chunk_size, [&](std::size_t begin, std::size_t end)
+        {
+            if constexpr (detail::is_batch_shader<VS>::value)
+            {
+                for(std::size_t i = begin; i < end;)
+                {
+                    const std::size_t v = i % vertices.size();
+                    if(!referenced.empty() && !referenced[v])
+                    {
+                        i++;
+                        continue;
+                    }
+
+                    const std::size_t run_end = std::min(end, i - v + vertices.size());
+                    std::size_t count = 1;
+                    while(i + count < run_end && (referenced.empty() || referenced[v + count])) count++;
+
+                    std::span<const Vertex> in(vertices.data() + v, count);
+                    if constexpr (instanced)
+                    {
+                        program.m_vertShader.shader(program.m_uniforms, in, instances[i / vertices.size()], out.subspan(i, count));
+                    }
+                    else
+                    {
+                        program.m_vertShader.shader(program.m_uniforms, in, out.subspan(i, count));
+                    }
+
+                    for(std::size_t k = i; k < i + count; k++) finish_vertex(k);
+                    i += count;
+                }
+            }
+            else
+            {
+                for(std::size_t i = begin; i < end; i++)
+                {
+                    if constexpr (instanced)
+                    {
+                        const std::size_t v = i % vertices.size();
+                        if(!referenced.empty() && !referenced[v]) continue;
+
+                        program.m_vertShader(program.m_uniforms, vertices[v], instances[i / vertices.size()], out[i]);
+                    }
+                    else
+                    {
+                        if(!referenced.empty() && !referenced[i]) continue;
+
+                        program.m_vertShader(program.m_uniforms, vertices[i], out[i]);
+                    }
+
+                    finish_vertex(i);
+                }
+            }
+        });
     }
 
     template<typename Varying>
@@ -120,128 +614,684 @@ private:
         out.position.y = options.viewport.min.y + (out.position.y + 1.0f) / 2.0f * (options.viewport.max.y - options.viewport.min.y);
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename... Targets>
-    void draw_triangles(const std::vector<Varying>& in, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, Framebuffer<Targets...>& fb, const Options& options)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void draw_triangles(std::span<const Varying> in, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
     {
-        for(unsigned int i = 0; i < in.size() / 3; i++)
+        auto fetch = [](std::size_t i, std::size_t& i_0, std::size_t& i_1, std::size_t& i_2)
         {
-            draw_triangle(in[i*3 + 0], in[i*3 + 1], in[i*3 + 2], program, fb, options);
+            i_0 = i*3 + 0; i_1 = i*3 + 1; i_2 = i*3 + 2;
+        };
+
+        if(options.binning)
+        {
+            draw_triangles_binned(in.size() / 3, fetch, in, program, fb, options);
+        }
+        else
+        {
+            draw_triangles_serial(in.size() / 3, fetch, in, program, fb, options);
         }
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms,  typename... Targets>
-    void draw_triangles_wireframe(const std::vector<Varying>& in, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, Framebuffer<Targets...>& fb, const Options& options)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS,  typename... Targets>
+    void draw_triangles_wireframe(std::span<const Varying> in, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
     {
         for(unsigned int i = 0; i < in.size() / 3; i++)
         {
-            draw_line(in[i*3 + 0], in[i*3 + 1], program, fb, options);
-            draw_line(in[i*3 + 1], in[i*3 + 2], program, fb, options);
-            draw_line(in[i*3 + 2], in[i*3 + 0], program, fb, options);
+            draw_line(i*3 + 0, i*3 + 1, in, program, fb, options);
+            draw_line(i*3 + 1, i*3 + 2, in, program, fb, options);
+            draw_line(i*3 + 2, i*3 + 0, in, program, fb, options);
         }
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename Indx,  typename... Targets>
-    void draw_triangles(const std::vector<Varying>& in, const std::vector<Indx>& indices, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, Framebuffer<Targets...>& fb, const Options& options)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Indx,  typename... Targets>
+    void draw_triangles(std::span<const Varying> in, std::span<const Indx> indices, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
     {
-        for(unsigned int i = 0; i < indices.size() / 3; i++)
+        auto fetch = [&indices](std::size_t i, std::size_t& i_0, std::size_t& i_1, std::size_t& i_2)
         {
-            draw_triangle(in[ indices[i*3 + 0] ], in[ indices[i*3 + 1] ], in[ indices[i*3 + 2] ], program, fb, options);
+            i_0 = indices[i*3 + 0]; i_1 = indices[i*3 + 1]; i_2 = indices[i*3 + 2];
+        };
+
+        if(options.binning)
+        {
+            draw_triangles_binned(indices.size() / 3, fetch, in, program, fb, options);
+        }
+        else
+        {
+            draw_triangles_serial(indices.size() / 3, fetch, in, program, fb, options);
         }
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename Indx,  typename... Targets>
-    void draw_triangles_wireframe(const std::vector<Varying>& in, const std::vector<Indx>& indices, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, Framebuffer<Targets...>& fb, const Options& options)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Indx,  typename... Targets>
+    void draw_triangles_wireframe(std::span<const Varying> in, std::span<const Indx> indices, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
     {
         for(unsigned int i = 0; i < indices.size() / 3; i++)
         {
-            draw_line(in[ indices[i*3 + 0] ], in[ indices[i*3 + 1] ], program, fb, options);
-            draw_line(in[ indices[i*3 + 1] ], in[ indices[i*3 + 2] ], program, fb, options);
-            draw_line(in[ indices[i*3 + 2] ], in[ indices[i*3 + 0] ], program, fb, options);
+            draw_line(indices[i*3 + 0], indices[i*3 + 1], in, program, fb, options);
+            draw_line(indices[i*3 + 1], indices[i*3 + 2], in, program, fb, options);
+            draw_line(indices[i*3 + 2], indices[i*3 + 0], in, program, fb, options);
+        }
+    }
+
+    /*
+     * primitive assembly of the triangle with vertex indices i_0, i_1, i_2
+     * -> triangles outside of one clip plane are rejected, triangles inside of all planes are emitted unchanged
+     * -> all other triangles are clipped in clip space; the projected vertices of the clipped polygon are
+     *    appended to storage (a deque, so references to them stay valid) and emitted as triangle fan
+    */
+    template<typename Varying, typename Emit>
+    void assemble_triangle(std::size_t i_0, std::size_t i_1, std::size_t i_2, std::span<const Varying> in, std::deque<Varying>& storage, const Options& options, TriangleCounters& counters, const Emit& emit)
+    {
+        std::uint8_t code_0 = m_clip_codes[i_0];
+        std::uint8_t code_1 = m_clip_codes[i_1];
+        std::uint8_t code_2 = m_clip_codes[i_2];
+
+        counters.triangles++;
+
+        if(code_0 & code_1 & code_2)
+        {
+            counters.outside++;
+            return;
+        }
+        if(!(code_0 | code_1 | code_2))
+        {
+            emit(in[i_0], in[i_1], in[i_2]);
+            return;
+        }
+
+        std::array<Varying, detail::max_clip_vertices> polygon;
+        const std::size_t indices[3] = { i_0, i_1, i_2 };
+        for(int k = 0; k < 3; k++)
+        {
+            polygon[k] = in[indices[k]];
+            polygon[k].position = m_clip_positions[indices[k]];
+        }
+
+        int count = detail::clip_polygon(polygon, 3, code_0 | code_1 | code_2);
+        if(count < 3)
+        {
+            counters.outside++;
+            return;
+        }
+
+        std::size_t base = storage.size();
+        for(int k = 0; k < count; k++)
+        {
+            auto& v = storage.emplace_back();
+            v = polygon[k];
+            post_process_vertices(v, options);
+        }
+
+        for(int k = 1; k + 1 < count; k++)
+        {
+            emit(storage[base], storage[base + k], storage[base + k + 1]);
         }
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename... Targets>
-    void draw_triangle(const Varying& v_0, const Varying& v_1, const Varying& v_2, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, Framebuffer<Targets...>& fb, const Options& options)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Fetch, typename... Targets>
+    void draw_triangles_serial(std::size_t count, const Fetch& fetch, std::span<const Varying> in, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
     {
-        if(options.culling)
+        auto& clipped = scratch().acquire<std::deque<Varying>>(1).front();
+
+        TriangleCounters counters;
+        for(std::size_t i = 0; i < count; i++)
         {
-            auto normal = cross(Vec3(v_1.position) - Vec3(v_0.position), Vec3(v_2.position) - Vec3(v_0.position));
-            if(normal.z < 0.0f) return;
+            std::size_t i_0, i_1, i_2;
+            fetch(i, i_0, i_1, i_2);
+
+            assemble_triangle(i_0, i_1, i_2, in, clipped, options, counters, [&](const Varying& v_0, const Varying& v_1, const Varying& v_2)
+            {
+                draw_triangle(v_0, v_1, v_2, program, fb, options, counters);
+            });
+
+            clipped.clear();
         }
 
-        Recti bbox(v_0.position, v_1.position, v_2.position);
-        bbox.clamp(options.viewport, 0, -1);
+        add_stats(counters);
+    }
+
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Fetch, typename... Targets>
+    void draw_triangles_binned(std::size_t count, const Fetch& fetch, std::span<const Varying> in, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
+    {
+        struct Triangle
+        {
+            detail::TriangleSetup setup;
+            const Varying* v_0;
+            const Varying* v_1;
+            const Varying* v_2;
+        };
+
+        /* clipping may split triangles, so every chunk collects its own output (and clipped vertices) */
+        struct Chunk
+        {
+            std::vector<Triangle> triangles;
+            std::deque<Varying> clipped;
+            TriangleCounters counters;
+        };
 
-        for(int x = bbox.min.x; x <= bbox.max.x; x++)
+        /* primitive assembly and triangle setup */
+        std::span<Chunk> chunks = scratch().acquire<Chunk>((count + triangle_chunk_size - 1) / triangle_chunk_size);
+        m_jobs.parallel_for(chunks.size(), 1, [&](std::size_t begin, std::size_t end)
         {
-            for(int y = bbox.min.y; y <= bbox.max.y; y++)
+            for(std::size_t c = begin; c < end; c++)
             {
-                Vec2 fragCoord = Vec2(x + 0.5f, y + 0.5f);
-                auto bc = barycentric(Vec2(v_0.position), Vec2(v_1.position), Vec2(v_2.position), fragCoord);
-                if(bc.x < 0 || bc.y < 0 || bc.z < 0 || std::isnan(bc.x)) continue;
+                auto& chunk = chunks[c];
+                chunk.triangles.clear();
+                chunk.clipped.clear();
+                chunk.counters = TriangleCounters();
 
-                /* linear interpolate in screen space */
-                float w = bc.x * v_0.position.w + bc.y * v_1.position.w + bc.z * v_2.position.w;
-                float z = bc.x * v_0.position.z + bc.y * v_1.position.z + bc.z * v_2.position.z;
-                z = z * 0.5f + 0.5f;
+                std::size_t last = std::min(count, (c + 1) * triangle_chunk_size);
+                for(std::size_t i = c * triangle_chunk_size; i < last; i++)
+                {
+                    std::size_t i_0, i_1, i_2;
+                    fetch(i, i_0, i_1, i_2);
 
-                /* TODO: clipping should happen earlier */
-                if(0.0f > z || z > 1.0f) continue;
+                    assemble_triangle(i_0, i_1, i_2, in, chunk.clipped, options, chunk.counters, [&](const Varying& v_0, const Varying& v_1, const Varying& v_2)
+                    {
+                        Triangle tri;
+                        if(!chunk.counters.accept(tri.setup.setup(v_0.position, v_1.position, v_2.position, cull_sign(options)), tri.setup)) return;
 
-                /* early depth test */
+                        tri.v_0 = &v_0; tri.v_1 = &v_1; tri.v_2 = &v_2;
+                        chunk.triangles.push_back(tri);
+                    });
+                }
+            }
+        });
+
+        std::size_t num_triangles = 0;
+        for(const auto& chunk : chunks)
+        {
+            add_stats(chunk.counters);
+            num_triangles += chunk.triangles.size();
+            scratch().track(chunk.triangles.size() * sizeof(Triangle) + chunk.clipped.size() * sizeof(Varying));
+        }
+
+        std::span<const Triangle*> triangles = scratch().acquire<const Triangle*>(num_triangles);
+        num_triangles = 0;
+        for(const auto& chunk : chunks)
+        {
+            for(const auto& tri : chunk.triangles)
+            {
+                triangles[num_triangles++] = &tri;
+            }
+        }
+
+        /* binning pass (serial to keep submission order within tiles) */
+        m_tiles.reset(options.viewport);
+        for(unsigned int i = 0; i < triangles.size(); i++)
+        {
+            m_tiles.insert(i, triangles[i]->setup);
+        }
+
+        /* rasterize tiles independently */
+        m_jobs.parallel_for(m_tiles.size(), 1, [&](std::size_t begin, std::size_t end)
+        {
+            for(std::size_t t = begin; t < end; t++)
+            {
+                Recti tile = m_tiles.tile(t);
+                for(unsigned int i : m_tiles.bin(t))
+                {
+                    const auto& tri = *triangles[i];
+                    rasterize_triangle(tri.setup, tile, *tri.v_0, *tri.v_1, *tri.v_2, program, fb);
+                }
+            }
+        });
+    }
+
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void draw_triangle(const Varying& v_0, const Varying& v_1, const Varying& v_2, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options, TriangleCounters& counters)
+    {
+        detail::TriangleSetup tri;
+        if(!counters.accept(tri.setup(v_0.position, v_1.position, v_2.position, cull_sign(options)), tri)) return;
+
+        Recti region(options.viewport.min.x, options.viewport.min.y, static_cast<int>(options.viewport.max.x) - 1, static_cast<int>(options.viewport.max.y) - 1);
+        rasterize_triangle(tri, region, v_0, v_1, v_2, program, fb);
+    }
+
+    /* rasterize the part of a set up triangle that lies inside region (inclusive pixel bounds) */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void rasterize_triangle(const detail::TriangleSetup& tri, const Recti& region, const Varying& v_0, const Varying& v_1, const Varying& v_2, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb)
+    {
+        Recti bbox = tri.bbox;
+        bbox.clamp(region);
+
+        if(bbox.min.x > bbox.max.x || bbox.min.y > bbox.max.y) return;
+
+        if constexpr (detail::is_depth_only<FS>::value)
+        {
+            /* the early depth test writes the depth of the passing pixels, nothing is shaded */
+            if(bbox.max.x - bbox.min.x < small_triangle_size && bbox.max.y - bbox.min.y < small_triangle_size)
+            {
+                traverse_small(tri, bbox, fb, [](int, int, int) {});
+            }
+            else
+            {
+                traverse_blocks(tri, bbox, fb, [&](const Recti& block, const RasterKernel::Edges& edges, int row_x, unsigned int lanes, bool depth_test, float& z_written)
+                {
+                    RasterKernel::Row row(edges, row_x, block.min.y);
+                    for(int y = block.min.y; y <= block.max.y; y++, row.next()) cover_row(tri, row, row_x, y, lanes, depth_test, z_written, fb);
+                });
+            }
+        }
+        else if constexpr (detail::is_packet_shader<FS>::value)
+        {
+            rasterize_triangle_packets(tri, bbox, v_0, v_1, v_2, program, fb);
+        }
+        else if(bbox.max.x - bbox.min.x < small_triangle_size && bbox.max.y - bbox.min.y < small_triangle_size)
+        {
+            rasterize_small_triangle(tri, bbox, v_0, v_1, v_2, program, fb);
+        }
+        else
+        {
+            rasterize_triangle_blocks(tri, bbox, v_0, v_1, v_2, program, fb);
+        }
+    }
+
+    /* rasterization of a triangle within bbox (clamped, not empty) by 8x8 pixel blocks, fragments are shaded one by one */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void rasterize_triangle_blocks(const detail::TriangleSetup& tri, const Recti& bbox, const Varying& v_0, const Varying& v_1, const Varying& v_2, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb)
+    {
+        detail::TriangleQuad<Varying> quad(tri, v_0, v_1, v_2);
+
+        traverse_blocks(tri, bbox, fb, [&](const Recti& block, const RasterKernel::Edges& edges, int row_x, unsigned int lanes, bool depth_test, float& z_written)
+        {
+            detail::QuadRows rows;
+            rows.x = row_x;
+            quad.rows = &rows;
+
+            /* pairs of rows (block rows are aligned to even y), the other pixels of the quads are at hand for derivatives */
+            RasterKernel::Row row(edges, row_x, block.min.y & ~1);
+            for(int y = block.min.y & ~1; y <= block.max.y; y += 2)
+            {
+                std::array<unsigned int, 2> mask = {};
+                for(int r = 0; r < 2; r++, row.next())
+                {
+                    if(y + r >= block.min.y && y + r <= block.max.y) mask[r] = cover_row(tri, row, row_x, y + r, lanes, depth_test, z_written, fb);
+                }
+
+                if(!(mask[0] | mask[1])) continue;
+
+                rows.y = y;
+                quad_rows(tri, rows);
+
+                for(int r = 0; r < 2; r++)
+                {
+                    for(; mask[r]; mask[r] &= mask[r] - 1) shade_fragment(row_x + std::countr_zero(mask[r]), y + r, quad, program, fb);
+                }
+            }
+        });
+    }
+
+    /*
+     * traverses the 8x8 pixel blocks of bbox; blocks outside of the triangle or behind the depth buffer are rejected as a whole
+     * -> rasterize_block(block, edges, row_x, lanes, depth_test, z_written) rasterizes the pixels of the block clamped to bbox;
+     *    edges are the edge functions of the triangle set up for the raster kernel, row_x is the first pixel of the block rows, lanes the mask of the pixels of a row inside of the clamped block,
+     *    depth_test false if the triangle is in front of everything in the block, and z_written the max depth written to it
+    */
+    template<typename Func, typename... Targets>
+    void traverse_blocks(const detail::TriangleSetup& tri, const Recti& bbox, Framebuffer<Targets...>& fb, const Func& rasterize_block)
+    {
+        constexpr int block_size = detail::DepthHierarchy::block_size;
+        const RasterKernel::Edges edges(tri.edge);
+
+        for(int block_y = bbox.min.y / block_size; block_y * block_size <= bbox.max.y; block_y++)
+        {
+            for(int block_x = bbox.min.x / block_size; block_x * block_size <= bbox.max.x; block_x++)
+            {
+                Recti block(block_x * block_size, block_y * block_size, block_x * block_size + block_size - 1, block_y * block_size + block_size - 1);
+                block.clamp(bbox);
+
+                if(!tri.overlaps(block)) continue;
+
+                /* hierarchical depth test: reject if the triangle is behind everything in the block,
+                 * skip per pixel tests if it is in front of everything */
+                bool depth_test = true;
                 if constexpr (Framebuffer<Targets...>::has_depth)
                 {
-                    auto& depth = fb.depth()(x, y);
-                    if(z > depth) continue;
-                    depth = z;
+                    auto& hierarchy = fb.depth_hierarchy();
+                    Vec2 z_bounds = tri.depth_bounds(block);
+
+                    if(z_bounds.x > hierarchy.max(block_x, block_y, fb.depth_target())) continue;
+                    depth_test = z_bounds.y > hierarchy.min(block_x, block_y);
                 }
 
-                /* perspective correction of barycentric coordinates */
-                bc.x = 1.0f / w * bc.x * v_0.position.w;
-                bc.y = 1.0f / w * bc.y * v_1.position.w;
-                bc.z = 1.0f / w * bc.z * v_2.position.w;
+                float z_written = std::numeric_limits<float>::max();
 
-                /* interpolate fragment data */
-                Varying inter;
-                interpolate_frag_data(bc, v_0, v_1, v_2, inter);
+                /* pixels of the block row inside of the (clamped) block */
+                const int row_x = block_x * block_size;
+                const unsigned int lanes = ((1u << (block.max.x - row_x + 1)) - 1) & ~((1u << (block.min.x - row_x)) - 1);
+
+                rasterize_block(block, edges, row_x, lanes, depth_test, z_written);
+
+                if constexpr (Framebuffer<Targets...>::has_depth)
+                {
+                    if(z_written != std::numeric_limits<float>::max()) fb.depth_hierarchy().update(block_x, block_y, z_written);
+                }
+            }
+        }
+    }
+
+    /* covered pixels (lanes) of the block row (row_x, y) passing the early depth test, which writes their depth; row holds the edge functions there */
+    template<typename... Targets>
+    unsigned int cover_row(const detail::TriangleSetup& tri, const RasterKernel::Row& row, int row_x, int y, unsigned int lanes, bool depth_test, float& z_written, Framebuffer<Targets...>& fb)
+    {
+        unsigned int mask = row.coverage() & lanes;
+        if(!mask) return 0;
+
+        /* early depth test, planes are evaluated at the first pixel center of the block row */
+        if constexpr (Framebuffer<Targets...>::has_depth)
+        {
+            Vec2 fragCoord = Vec2(row_x + 0.5f, y + 0.5f) - tri.origin;
+            Depth* depth_row = fb.depth_target().ptr() + y * fb.depth_target().width() + row_x;
+            mask = RasterKernel::depth_test(tri.depth(fragCoord.x, fragCoord.y), tri.depth.dx, depth_row, mask, lanes, depth_test, z_written);
+        }
+
+        return mask;
+    }
+
+    /* 1/w at the first pixel center of the block row (row_x, y); pixel i of the row adds i * tri.inv_w.dx */
+    static float inv_w_row(const detail::TriangleSetup& tri, int row_x, int y)
+    {
+        Vec2 fragCoord = Vec2(row_x + 0.5f, y + 0.5f) - tri.origin;
+        return tri.inv_w(fragCoord.x, fragCoord.y);
+    }
+
+    /* perspective correction of the pair of block rows rows.x, rows.y (see detail::QuadRows) */
+    static void quad_rows(const detail::TriangleSetup& tri, detail::QuadRows& rows)
+    {
+        for(int r = 0; r < 2; r++) RasterKernel::perspective(inv_w_row(tri, rows.x, rows.y + r), tri.inv_w.dx, tri.bc_scale, rows.w[r].data());
+    }
+
+    /* 2x2 pixel quad of a fragment packet: lower left pixel (even x and y) and perspective correction of its pixels (see detail::QuadRows) */
+    struct PacketQuad
+    {
+        int x = 0;
+        int y = 0;
+        std::array<std::array<float, 2>, fragment_packet_height> w = {};
+    };
+
+    /*
+     * block traversal for packet fragment shaders: pairs of block rows are split into 2x2 quads (see fragment_packet_width)
+     * -> every two quads with a pixel passing the depth test are shaded as one packet, whether adjacent or not,
+     *    so packets stay filled along edges and for small triangles
+     * -> all pixels of these quads are shaded (helper lanes), only the passing ones written
+     * -> no small triangle path: the bounds of small triangles rarely align to quads
+    */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void rasterize_triangle_packets(const detail::TriangleSetup& tri, const Recti& bbox, const Varying& v_0, const Varying& v_1, const Varying& v_2, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb)
+    {
+        static_assert(std::is_same_v<Framebuffer<Targets...>, DefaultFramebuffer>, "Packet fragment shaders only render to the default framebuffer");
+        static_assert(std::is_invocable_v<const decltype(FS::shader)&, const Uniforms&, const FragmentPacket<Varying>&, unsigned int, Vec4Packet<>&>,
+                      "Packet fragment shaders take (uniforms, in, mask, out)");
+        static_assert(fragment_packet_width == 4 && fragment_packet_height == 2 && RasterKernel::width % 2 == 0);
+
+        /* quads of the packet being filled, mask of their lanes to write */
+        std::array<PacketQuad, 2> quads;
+        int num_quads = 0;
+        unsigned int packet_mask = 0;
+
+        traverse_blocks(tri, bbox, fb, [&](const Recti& block, const RasterKernel::Edges& edges, int row_x, unsigned int row_lanes, bool depth_test, float& z_written)
+        {
+            detail::QuadRows rows;
+            rows.x = row_x;
+
+            /* block rows are aligned to even y (block_size is even), so are pairs of rows */
+            RasterKernel::Row row(edges, row_x, block.min.y & ~1);
+            for(int y = block.min.y & ~1; y <= block.max.y; y += fragment_packet_height)
+            {
+                std::array<unsigned int, fragment_packet_height> mask = {};
+                for(int r = 0; r < fragment_packet_height; r++, row.next())
+                {
+                    if(y + r >= block.min.y && y + r <= block.max.y) mask[r] = cover_row(tri, row, row_x, y + r, row_lanes, depth_test, z_written, fb);
+                }
+
+                if(!(mask[0] | mask[1])) continue;
 
-                /* call fragment shader, TODO: unecessary complicated to have two different function definitions? */
-                if constexpr (std::is_same_v<Framebuffer<Targets...>, DefaultFramebuffer>)
+                /* also for rows outside of the block, which may hold helper lanes */
+                rows.y = y;
+                quad_rows(tri, rows);
+
+                for(int column = 0; column < RasterKernel::width; column += 2)
                 {
-                    Vec4 fragColor(0, 0, 0, 0);
-                    program.m_fragShader(program.m_uniforms, inter, fragColor);
+                    const unsigned int quad_mask = ((mask[0] >> column) & 0b11) | (((mask[1] >> column) & 0b11) << fragment_packet_width);
+                    if(!quad_mask) continue;
+
+                    quads[num_quads] = { row_x + column, y, { { { rows.w[0][column], rows.w[0][column + 1] }, { rows.w[1][column], rows.w[1][column + 1] } } } };
+                    packet_mask |= quad_mask << (2 * num_quads);
 
-                    fb.color()(x, y) = RGBA8( max( min(fragColor, 1.0), 0.0) * 255 );
+                    if(++num_quads == 2)
+                    {
+                        shade_packet(quads, packet_mask, tri, v_0, v_1, v_2, program, fb);
+                        num_quads = 0;
+                        packet_mask = 0;
+                    }
                 }
-                else
+            }
+        });
+
+        if(num_quads)
+        {
+            quads[1] = quads[0];
+            shade_packet(quads, packet_mask, tri, v_0, v_1, v_2, program, fb);
+        }
+    }
+
+    /* computes the barycentric coordinates of the lanes of the quads, calls the packet shader and writes the lanes in mask */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS>
+    void shade_packet(const std::array<PacketQuad, 2>& quads, unsigned int mask, const detail::TriangleSetup& tri, const Varying& v_0, const Varying& v_1, const Varying& v_2,
+                      const Program<Vertex, Varying, Uniforms, DefaultFramebuffer, VS, FS>& program, DefaultFramebuffer& fb)
+    {
+        FragmentPacket<Varying> in{ {}, v_0, v_1, v_2 };
+
+        for(std::size_t lane = 0; lane < packet_size; lane++)
+        {
+            const PacketQuad& quad = quads[(lane % fragment_packet_width) / 2];
+            const int row = lane / fragment_packet_width;
+            const int x = quad.x + lane % 2;
+            const int y = quad.y + row;
+
+            /* perspective correct barycentric coordinates, as for single fragments */
+            const float w = quad.w[row][lane % 2];
+            in.bc.x[lane] = w * static_cast<float>(tri.edge[0](x, y)) * v_0.position.w;
+            in.bc.y[lane] = w * static_cast<float>(tri.edge[1](x, y)) * v_1.position.w;
+            in.bc.z[lane] = w * static_cast<float>(tri.edge[2](x, y)) * v_2.position.w;
+        }
+
+        Vec4Packet<> fragColor;
+        program.m_fragShader.shader(program.m_uniforms, in, mask, fragColor);
+
+        /* conversion of all lanes at once */
+        Vec4Packet<> color = Vec4Packet<>(clamp(fragColor.x, 0.0f, 1.0f), clamp(fragColor.y, 0.0f, 1.0f), clamp(fragColor.z, 0.0f, 1.0f), clamp(fragColor.w, 0.0f, 1.0f)) * 255.0f;
+
+        for(; mask; mask &= mask - 1)
+        {
+            const int lane = std::countr_zero(mask);
+            const PacketQuad& quad = quads[(lane % fragment_packet_width) / 2];
+
+            fb.color()(quad.x + lane % 2, quad.y + lane / fragment_packet_width) = RGBA8(Vec4(color.x[lane], color.y[lane], color.z[lane], color.w[lane]));
+        }
+    }
+
+    /*
+     * rasterization of triangles with at most small_triangle_size x small_triangle_size pixel centers in bbox (clamped, not empty)
+     * -> one coverage test per row of the bounds instead of the traversal of 8x8 blocks
+     * -> no hierarchical depth test: for a few pixels the exact tests are cheaper than the block bounds
+     *    (the max of a block written to since the last query would have to be recomputed from all of its pixels);
+     *    written blocks (at most 2x2) still lower the block minimum
+     * -> planes are evaluated relative to the start of the block row, so fragments are identical to the block traversal
+    */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void rasterize_small_triangle(const detail::TriangleSetup& tri, const Recti& bbox, const Varying& v_0, const Varying& v_1, const Varying& v_2, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb)
+    {
+        detail::TriangleQuad<Varying> quad(tri, v_0, v_1, v_2);
+
+        /* row pairs of the (at most 2) block columns of bbox, computed when a fragment is shaded there */
+        constexpr int block_size = detail::DepthHierarchy::block_size;
+        std::array<detail::QuadRows, 2> rows;
+        rows[0].y = rows[1].y = -1;
+
+        traverse_small(tri, bbox, fb, [&](int x, int y, int row_x)
+        {
+            detail::QuadRows& quad_row = rows[row_x / block_size - bbox.min.x / block_size];
+            if(quad_row.y != (y & ~1))
+            {
+                quad_row.x = row_x;
+                quad_row.y = y & ~1;
+                quad_rows(tri, quad_row);
+            }
+
+            quad.rows = &quad_row;
+            shade_fragment(x, y, quad, program, fb);
+        });
+    }
+
+    /*
+     * traverses the covered pixels of a small triangle (see rasterize_small_triangle) with early depth test and depth write
+     * -> shade(x, y, row_x) is called for the passing pixels; row_x is the first pixel of the block row of x
+    */
+    template<typename Func, typename... Targets>
+    void traverse_small(const detail::TriangleSetup& tri, const Recti& bbox, Framebuffer<Targets...>& fb, const Func& shade)
+    {
+        static_assert(small_triangle_size <= RasterKernel::width);
+        constexpr int block_size = detail::DepthHierarchy::block_size;
+
+        const int block_x = bbox.min.x / block_size;
+        const int block_y = bbox.min.y / block_size;
+        float z_written[2][2] = { { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() },
+                                  { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() } };
+
+        const unsigned int lanes = (1u << (bbox.max.x - bbox.min.x + 1)) - 1;
+        const RasterKernel::Edges edges(tri.edge);
+        RasterKernel::Row row(edges, bbox.min.x, bbox.min.y);
+        for(int y = bbox.min.y; y <= bbox.max.y; y++, row.next())
+        {
+            for(unsigned int mask = row.coverage() & lanes; mask; mask &= mask - 1)
+            {
+                const int x = bbox.min.x + std::countr_zero(mask);
+                const int row_x = x - x % block_size;
+
+                /* early depth test */
+                if constexpr (Framebuffer<Targets...>::has_depth)
                 {
-                    auto targets = fb.targets(x, y);
-                    program.m_fragShader(program.m_uniforms, inter, targets);
+                    Vec2 fragCoord = Vec2(row_x + 0.5f, y + 0.5f) - tri.origin;
+                    Depth* depth_row = fb.depth_target().ptr() + y * fb.depth_target().width() + row_x;
+                    float& z_block = z_written[y / block_size - block_y][row_x / block_size - block_x];
+                    if(detail::RasterKernelScalar::depth_test_lane(x - row_x, tri.depth(fragCoord.x, fragCoord.y), tri.depth.dx, depth_row, true, z_block)) continue;
                 }
+
+                shade(x, y, row_x);
+            }
+        }
+
+        if constexpr (Framebuffer<Targets...>::has_depth)
+        {
+            for(int k = 0; k < 4; k++)
+            {
+                if(z_written[k / 2][k % 2] != std::numeric_limits<float>::max()) fb.depth_hierarchy().update(block_x + k % 2, block_y + k / 2, z_written[k / 2][k % 2]);
             }
         }
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename... Targets>
-    void draw_lines(const std::vector<Varying>& in, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, Framebuffer<Targets...>& fb, const Options& options)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void shade_fragment(int x, int y, detail::TriangleQuad<Varying>& quad, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb)
+    {
+        /* derivatives (dFdx, dFdy) of the fragment shader refer to the quad of this fragment */
+        quad.x = x;
+        quad.y = y;
+
+        const Vec3 bc = quad.barycentrics(x, y);
+
+        if constexpr (detail::is_lazy_shader<FS>::value)
+        {
+            /* members are interpolated by the shader (load) */
+            const LazyFragment<Varying> in{ bc, quad.v_0, quad.v_1, quad.v_2 };
+
+            quad.input = &in;
+            write_fragment(x, y, program.m_fragShader.shader, program.m_uniforms, in, fb);
+        }
+        else
+        {
+            /* interpolate fragment data */
+            Varying inter;
+            interpolate_frag_data(bc, quad.v_0, quad.v_1, quad.v_2, inter);
+
+            quad.input = &inter;
+            quad.varyings = &inter;
+            write_fragment(x, y, program.m_fragShader, program.m_uniforms, inter, fb);
+        }
+    }
+
+    /* calls the fragment shader with input in and writes its output to pixel (x, y) */
+    template<typename Shader, typename Uniforms, typename Input, typename... Targets>
+    void write_fragment(int x, int y, const Shader& shader, const Uniforms& uniforms, const Input& in, Framebuffer<Targets...>& fb)
+    {
+        /* call fragment shader, TODO: unecessary complicated to have two different function definitions? */
+        if constexpr (std::is_same_v<Framebuffer<Targets...>, DefaultFramebuffer>)
+        {
+            Vec4 fragColor(0, 0, 0, 0);
+            shader(uniforms, in, fragColor);
+
+            fb.color()(x, y) = RGBA8( max( min(fragColor, 1.0), 0.0) * 255 );
+        }
+        else
+        {
+            auto targets = fb.targets(x, y);
+            shader(uniforms, in, targets);
+
+            /* the shader gets the depth target too, register what it has written */
+            if constexpr (Framebuffer<Targets...>::has_depth)
+            {
+                constexpr int block_size = detail::DepthHierarchy::block_size;
+                constexpr auto depth_index = detail::tuple_index<Texture<Depth>, typename Framebuffer<Targets...>::TargetStorage>::index;
+                fb.depth_hierarchy().update(x / block_size, y / block_size, std::get<depth_index>(targets));
+            }
+        }
+    }
+
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void draw_lines(std::span<const Varying> in, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
     {
         for(unsigned int i = 0; i < in.size() / 2; i++)
         {
-            draw_line(in[i*2 + 0], in[i*2 + 1], program, fb, options);
+            draw_line(i*2 + 0, i*2 + 1, in, program, fb, options);
         }
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename Indx, typename... Targets>
-    void draw_lines(const std::vector<Varying>& in, const std::vector<Indx>& indices, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, Framebuffer<Targets...>& fb, const Options& options)
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename Indx, typename... Targets>
+    void draw_lines(std::span<const Varying> in, std::span<const Indx> indices, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
     {
         for(unsigned int i = 0; i < indices.size() / 2; i++)
         {
-            draw_line(in[ indices[i*2 + 0] ], in[ indices[i*2 + 1] ], program, fb, options);
+            draw_line(indices[i*2 + 0], indices[i*2 + 1], in, program, fb, options);
         }
     }
 
-    template<typename Vertex, typename Varying, typename Uniforms, typename... Targets>
-    void draw_line(const Varying& v_0, const Varying& v_1, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>>& program, Framebuffer<Targets...>& fb, const Options& options)
+    /* primitive assembly of the line with vertex indices i_0, i_1 (clipped in clip space if necessary) */
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void draw_line(std::size_t i_0, std::size_t i_1, std::span<const Varying> in, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
+    {
+        std::uint8_t code_0 = m_clip_codes[i_0];
+        std::uint8_t code_1 = m_clip_codes[i_1];
+
+        if(code_0 & code_1) return;
+        if(!(code_0 | code_1))
+        {
+            draw_line(in[i_0], in[i_1], program, fb, options);
+            return;
+        }
+
+        Varying v_0, v_1;
+        v_0 = in[i_0]; v_0.position = m_clip_positions[i_0];
+        v_1 = in[i_1]; v_1.position = m_clip_positions[i_1];
+
+        if(!detail::clip_line(v_0, v_1, code_0 | code_1)) return;
+
+        post_process_vertices(v_0, options);
+        post_process_vertices(v_1, options);
+        draw_line(v_0, v_1, program, fb, options);
+    }
+
+    template<typename Vertex, typename Varying, typename Uniforms, typename VS, typename FS, typename... Targets>
+    void draw_line(const Varying& v_0, const Varying& v_1, const Program<Vertex, Varying, Uniforms, Framebuffer<Targets...>, VS, FS>& program, Framebuffer<Targets...>& fb, const Options& options)
     {
         /* clamp to viewport */
         auto v0 = clamp(options.viewport, Vec2(v_0.position), 0.0f, -1.0f);
@@ -272,37 +1322,47 @@ private:
             float z = ic.x * v_0.position.z + ic.y * v_1.position.z;
             z = z * 0.5f + 0.5f;
 
-            /* TODO: clipping should happen earlier */
-            if(0.0f > z || z > 1.0f) continue;
-
             /* early depth test */
             if constexpr (Framebuffer<Targets...>::has_depth)
             {
-                auto& depth = fb.depth()(pixelCoord.x, pixelCoord.y);
+                auto& depth = fb.depth_target()(pixelCoord.x, pixelCoord.y);
                 if(z > depth) continue;
                 depth = z;
+
+                constexpr int block_size = detail::DepthHierarchy::block_size;
+                fb.depth_hierarchy().update(pixelCoord.x / block_size, pixelCoord.y / block_size, z);
             }
 
             /* perspective correction of linear coordinates */
             ic.x = 1.0f / w * ic.x * v_0.position.w;
             ic.y = 1.0f / w * ic.y * v_1.position.w;
 
-            /* interpolate fragment data */
-            Varying inter;
-            interpolate_frag_data(ic, v_0, v_1, inter);
-
-            /* call fragment shader, TODO: unecessary complicated to have two different function definitions? */
-            if constexpr (std::is_same_v<Framebuffer<Targets...>, DefaultFramebuffer>)
+            if constexpr (detail::is_depth_only<FS>::value)
+            {
+                /* depth was written by the early depth test */
+            }
+            else if constexpr (detail::is_packet_shader<FS>::value)
             {
-                Vec4 fragColor(0, 0, 0, 0);
-                program.m_fragShader(program.m_uniforms, inter, fragColor);
+                /* line fragments of packet shaders are shaded in packets of one fragment, all lanes hold it (no derivatives) */
+                FragmentPacket<Varying> in{ Vec3Packet<>(ic.x, ic.y, 0.0f), v_0, v_1, v_0 };
 
-                fb.color()(pixelCoord.x, pixelCoord.y) = RGBA8( max( min(fragColor, 1.0), 0.0) * 255 );
+                Vec4Packet<> fragColor;
+                program.m_fragShader.shader(program.m_uniforms, in, 1u, fragColor);
+
+                Vec4 color(fragColor.x[0], fragColor.y[0], fragColor.z[0], fragColor.w[0]);
+                fb.color()(pixelCoord.x, pixelCoord.y) = RGBA8( max( min(color, 1.0), 0.0) * 255 );
+            }
+            else if constexpr (detail::is_lazy_shader<FS>::value)
+            {
+                write_fragment(pixelCoord.x, pixelCoord.y, program.m_fragShader.shader, program.m_uniforms, LazyFragment<Varying>{ Vec3(ic.x, ic.y, 0.0f), v_0, v_1, v_0 }, fb);
             }
             else
             {
-                auto targets = fb.targets(pixelCoord.x, pixelCoord.y);
-                program.m_fragShader(program.m_uniforms, inter, targets);
+                /* interpolate fragment data */
+                Varying inter;
+                interpolate_frag_data(ic, v_0, v_1, inter);
+
+                write_fragment(pixelCoord.x, pixelCoord.y, program.m_fragShader, program.m_uniforms, inter, fb);
             }
         }
     }
@@ -334,4 +1394,28 @@ private:
 private:
     DefaultFramebuffer m_framebuffer;
     Options m_options;
+
+    /* job system of the renderer, unless it was given one */
+    std::unique_ptr<JobSystem> m_own_jobs;
+    JobSystem& m_jobs;
+
+    detail::TileGrid m_tiles;
+
+    Stats m_stats;
+
+    /*
+     * storage of all intermediate data of a draw, reused by the following draws
+     * -> submit alternates between the pools, so the draw being shaded and the draw being rasterized never share one
+    */
+    detail::ScratchPool m_scratch[2];
+    int m_scratch_current = 0;
+
+    /* scratch storage of the current draw */
+    detail::ScratchPool& scratch() { return m_scratch[m_scratch_current]; }
+
+    /* clip space positions and outcodes of the processed vertices of the current draw */
+    std::span<Vec4> m_clip_positions;
+    std::span<std::uint8_t> m_clip_codes;
+
+    friend struct CommandBuffer;
 };
@@ -1,19 +1,25 @@
 #pragma once
 
 #include "texture.h"
+#include "derivatives.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
 
 template<typename T> struct Sampler;
 template<typename T> T texture(const Sampler<T>& sampler, const Vec2& uv);
 
 
+/* texel filter, mip map filters as <between levels>_MIPMAP_<within a level>; NEAREST and LINEAR only sample the base level */
 enum class eFilter
 {
     NEAREST,
     LINEAR,
     NEAREST_MIPMAP_LINEAR,
     LINEAR_MIPMAP_NEAREST,
+    LINEAR_MIPMAP_LINEAR,   /* trilinear */
 };
 
 enum class eWrap
@@ -39,6 +45,7 @@ struct Sampler
     Sampler& operator =(const Texture<T>& texture)
     {
         m_texture = &texture;
+        return *this;
     }
 
 
@@ -79,7 +86,7 @@ T sample_texture(const TextureStorage<T>& textureStorage, const Vec2& uv, eWrap
 
         return textureStorage(coord.x, coord.y);
     }
-    else if(filter == eFilter::LINEAR || filter == eFilter::NEAREST_MIPMAP_LINEAR)
+    else if(filter == eFilter::LINEAR || filter == eFilter::NEAREST_MIPMAP_LINEAR || filter == eFilter::LINEAR_MIPMAP_LINEAR)
     {
         /* TODO: apply wrapping for interpolation coords  */
         Vec2 coord = Vec2(proj_uv.x * width - 0.5f, proj_uv.y * height - 0.5f);
@@ -105,13 +112,6 @@ T sample_texture(const TextureStorage<T>& textureStorage, const Vec2& uv, eWrap
     return T();
 }
 
-template<typename T>
-T texture(const Sampler<T>& sampler, const Vec2& uv)
-{
-    assert(sampler.m_texture != nullptr);
-    return sample_texture(sampler.m_texture->mipmaps().front(), uv, sampler.wrap, sampler.filter);
-}
-
 template<typename T>
 T textureLod(const Sampler<T>& sampler, const Vec2& uv, float level)
 {
@@ -125,14 +125,89 @@ T textureLod(const Sampler<T>& sampler, const Vec2& uv, float level)
     {
         float floor_level = std::floor(sample_level);
         float ceil_level = std::ceil(sample_level);
-        float weight = ceil_level - sample_level;
+        float weight = sample_level - floor_level;
 
         auto floor_sample = sample_texture(sampler.m_texture->mipmaps().at(floor_level), uv, sampler.wrap, sampler.filter);
+        if(weight == 0.0f) return floor_sample;
+
         auto ceil_sample = sample_texture(sampler.m_texture->mipmaps().at(ceil_level), uv, sampler.wrap, sampler.filter);
         return weight * ceil_sample + (1.0f - weight) * floor_sample;
     }
 }
 
+/* mip level of the footprint of a pixel with the uv derivatives ddx, ddy (the longer axis in texels); may be negative or exceed the mip chain */
+template<typename T>
+float textureQueryLod(const Sampler<T>& sampler, const Vec2& ddx, const Vec2& ddy)
+{
+    Vec2 size(sampler.m_texture->width(), sampler.m_texture->height());
+    Vec2 dx = ddx * size;
+    Vec2 dy = ddy * size;
+
+    /* log2 of the length, without the square root */
+    return 0.5f * std::log2(std::max({ dot(dx, dx), dot(dy, dy), std::numeric_limits<float>::min() }));
+}
+
+/* samples with the mip level of explicit uv derivatives */
+template<typename T>
+T textureGrad(const Sampler<T>& sampler, const Vec2& uv, const Vec2& ddx, const Vec2& ddy)
+{
+    return textureLod(sampler, uv, textureQueryLod(sampler, ddx, ddy));
+}
+
+namespace detail
+{
+    /* mip map filter with a mip chain to select from */
+    template<typename T>
+    bool is_mip_mapped(const Sampler<T>& sampler)
+    {
+        return sampler.filter != eFilter::NEAREST && sampler.filter != eFilter::LINEAR && sampler.m_texture->num_mipmaps() > 1;
+    }
+}
+
+/*
+ * Samples with the mip level of the screen space footprint of uv in a fragment shader with input in (for mip map filters)
+ * -> uv is a member of the varyings (texture(sampler, in, &Varying::uv)) or a function of the input for computed coordinates
+ *    (tiling, offsets, parallax: texture(sampler, in, [](const Varying& v) { return v.uv * 4.0f; })); its derivatives are
+ *    differences over the quad of the fragment (see dFdx), line fragments have none and sample the base level
+ * -> the precise path: texture(sampler, uv) has to match uv to the varyings and estimates computed coordinates
+*/
+template<typename T, typename Input, typename UV>
+    requires std::is_member_object_pointer_v<UV> || std::is_invocable_v<const UV&, const Input&>
+T texture(const Sampler<T>& sampler, const Input& in, const UV& uv)
+{
+    assert(sampler.m_texture != nullptr);
+
+    const Vec2 coord = detail::fragment_value(in, uv);
+    if(detail::is_mip_mapped(sampler))
+    {
+        return textureGrad(sampler, coord, detail::quad_difference(in, uv, coord, 0), detail::quad_difference(in, uv, coord, 1));
+    }
+
+    return sample_texture(sampler.m_texture->mipmaps().front(), coord, sampler.wrap, sampler.filter);
+}
+
+/*
+ * Samples with the mip level of the screen space footprint of uv, taken from the varyings of the fragment (for mip map filters)
+ * -> uv takes the differences over the quad of the closest Vec2 varying at the fragment (see TriangleQuad::find_uv_derivatives):
+ *    exact for varyings (in.uv, load(in, &Varying::uv)) and offsets of them, an estimate for other computed coordinates
+ * -> texture(sampler, in, uv) is the precise path, also for computed coordinates; outside of triangle fragments
+ *    (lines, packet shaders, no shader) the base level is sampled
+*/
+template<typename T>
+T texture(const Sampler<T>& sampler, const Vec2& uv)
+{
+    assert(sampler.m_texture != nullptr);
+
+    const detail::FragmentQuad* quad = detail::current_fragment_quad;
+    Vec2 ddx, ddy;
+    if(detail::is_mip_mapped(sampler) && quad && quad->uv_derivatives(*quad, uv, ddx, ddy))
+    {
+        return textureGrad(sampler, uv, ddx, ddy);
+    }
+
+    return sample_texture(sampler.m_texture->mipmaps().front(), uv, sampler.wrap, sampler.filter);
+}
+
 template<typename T>
 Vec2i textureSize( const Sampler<T>& sampler )
 {
@@ -144,3 +219,54 @@ Vec2 textureInvSize( const Sampler<T>& sampler )
 {
     return Vec2( 1.0f / sampler.m_texture->width(), 1.0f / sampler.m_texture->height() );
 }
+
+
+/*
+ * Packet sampling (see packet_shader): texels of all lanes converted to floats (as Vec4(texel))
+ * -> texture selects the mip level of each lane from the derivatives of the uv packet, so uv may be computed
+ * -> lanes are sampled one by one, texture fetches do not vectorize; lanes outside of mask (e.g. helper lanes) are not sampled
+*/
+namespace detail
+{
+    template<typename Sample>
+    Vec4Packet<> sample_lanes(unsigned int mask, const Sample& sample)
+    {
+        Vec4Packet<> texels(Packet<>(0.0f));
+        for(std::size_t i = 0; i < packet_size; i++)
+        {
+            if(!(mask & (1u << i))) continue;
+
+            Vec4 texel = Vec4(sample(i));
+            texels.x[i] = texel.x; texels.y[i] = texel.y; texels.z[i] = texel.z; texels.w[i] = texel.w;
+        }
+        return texels;
+    }
+}
+
+template<typename T>
+Vec4Packet<> textureLod(const Sampler<Vector4<T>>& sampler, const Vec2Packet<>& uv, const Packet<>& level, unsigned int mask = ~0u)
+{
+    return detail::sample_lanes(mask, [&](std::size_t i) { return textureLod(sampler, Vec2(uv.x[i], uv.y[i]), level[i]); });
+}
+
+template<typename T>
+Vec4Packet<> texture(const Sampler<Vector4<T>>& sampler, const Vec2Packet<>& uv, unsigned int mask = ~0u)
+{
+    assert(sampler.m_texture != nullptr);
+
+    if(detail::is_mip_mapped(sampler))
+    {
+        Vec2Packet<> ddx = dFdx(uv);
+        Vec2Packet<> ddy = dFdy(uv);
+
+        return detail::sample_lanes(mask, [&](std::size_t i)
+        {
+            return textureGrad(sampler, Vec2(uv.x[i], uv.y[i]), Vec2(ddx.x[i], ddx.y[i]), Vec2(ddy.x[i], ddy.y[i]));
+        });
+    }
+
+    return detail::sample_lanes(mask, [&](std::size_t i)
+    {
+        return sample_texture(sampler.m_texture->mipmaps().front(), Vec2(uv.x[i], uv.y[i]), sampler.wrap, sampler.filter);
+    });
+}
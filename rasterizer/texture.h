@@ -116,13 +116,18 @@ struct Texture
         return save_texture<T>(*this, filepath);
     }
 
+    /* replaces all levels but the base level by a full mip chain (down to 1x1) */
     void generate_mipmaps()
     {
         int level_width = width();
         int level_height = height();
         int max_levels = 1 + floor(std::log2(std::max(level_width, level_height)));
 
-        for(int i = 0; i < max_levels; i++)
+        /* no reallocation while the previous level is referenced */
+        m_mipmaps.resize(1);
+        m_mipmaps.reserve(max_levels);
+
+        for(int i = 0; i + 1 < max_levels; i++)
         {
             level_width = std::max(1, level_width / 2);
             level_height = std::max(1, level_height / 2);
@@ -0,0 +1,61 @@
+#include <cstdlib>
+#include <cstdio>
+#include <stdexcept>
+
+#include <command_buffer.h>
+
+/* draws have to render to the framebuffer bound when they are recorded */
+
+struct Vertex
+{
+    Vec3 pos;
+};
+
+struct Varying
+{
+    Vec4 position;
+
+    VARYING(position);
+};
+
+struct Uniforms
+{
+
+};
+
+int main(int argc, char** argv)
+{
+    Program<Vertex, Varying, Uniforms> program;
+    program.onVertex([](const auto& uniform, const auto& in, auto& out) { out.position = Vec4(in.pos, 1.0f); });
+    program.onFragment([](const auto& uniform, const auto& in, auto& out) { out = Vec4(1.0f, 0.0f, 0.0f, 1.0f); });
+
+    Buffer<Vertex> triangle;
+    triangle.primitive = ePrimitive::TRIANGLES;
+    triangle.vertices = { { {-0.5, -0.5, 0.5} }, { { 0.5, -0.5, 0.5} }, { { 0.0,  0.5, 0.5} } };
+
+    Framebuffer<RGBA8> framebuffer(64, 64);
+    CommandBuffer commands;
+    bool passed = true;
+
+    /* program for the default framebuffer */
+    commands.draw(program, triangle);
+
+    commands.bind(framebuffer);
+    try
+    {
+        commands.draw(program, triangle);
+        std::printf("draw to a framebuffer with other targets than the program was recorded\n");
+        passed = false;
+    }
+    catch(const std::logic_error&)
+    {
+    }
+
+    if(commands.size() != 1)
+    {
+        std::printf("rejected draw left %zu commands instead of 1\n", commands.size());
+        passed = false;
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
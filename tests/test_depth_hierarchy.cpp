@@ -0,0 +1,116 @@
+#include <cstdlib>
+#include <cstdio>
+
+#include <renderer.h>
+
+/*
+ * Depth written past the early depth test (by fragment shaders or through Framebuffer::depth()) has to keep later triangles depth tested
+ * -> the near pixels only cover a part of a block, the block stays visible for triangles in between
+*/
+
+struct Vertex
+{
+    Vec3 pos;
+};
+
+struct Varying
+{
+    Vec4 position;
+
+    VARYING(position);
+};
+
+struct Uniforms
+{
+    float x_max;
+    float z;
+    Vec4 color;
+    bool write_depth;
+};
+
+using GBuffer = Framebuffer<Vec4, Depth>;
+
+/* pixels left of x_split are in front (red), the other ones behind the quad drawn last (green) */
+static bool check_color(GBuffer& fb, int x_split, const char* test)
+{
+    for(int y = 0; y < fb.target<0>().height(); y++)
+    {
+        for(int x = 0; x < fb.target<0>().width(); x++)
+        {
+            Vec4 expected = x < x_split ? Vec4(1, 0, 0, 1) : Vec4(0, 1, 0, 1);
+            if(!(fb.target<0>()(x, y) == expected))
+            {
+                std::printf("%s: wrong color at pixel (%d, %d)\n", test, x, y);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Program<Vertex, Varying, Uniforms, GBuffer> program;
+    program.onVertex([](const auto& uniform, const auto& in, auto& out)
+    {
+        out.position = Vec4(in.pos.x > 0.0f ? uniform.x_max : -1.0f, in.pos.y, uniform.z, 1.0f);
+    });
+
+    program.onFragment([](const auto& uniform, const auto& in, auto& out)
+    {
+        auto& [color, depth] = out;
+        color = uniform.color;
+        if(uniform.write_depth) depth = 0.1f;
+    });
+
+    /* quad from x = -1 to x_max */
+    Buffer<Vertex> quad;
+    quad.primitive = ePrimitive::TRIANGLES;
+    quad.vertices = { { {-1.0, -1.0, 0.0} }, { { 1.0, -1.0, 0.0} }, { { 1.0,  1.0, 0.0} },
+                      { {-1.0, -1.0, 0.0} }, { { 1.0,  1.0, 0.0} }, { {-1.0,  1.0, 0.0} } };
+
+    const Vec4 red(1, 0, 0, 1);
+    const Vec4 green(0, 1, 0, 1);
+    const Vec4 blue(0, 0, 1, 1);
+
+    /* the split at pixel 34 lies inside of the 8x8 block from pixel 32 to 39 */
+    const int size = 64;
+    const int x_split = 34;
+    const float x_max = 2.0f * x_split / size - 1.0f;
+
+    GBuffer fb(size, size);
+    Renderer rasterizer(size, size);
+    bool passed = true;
+
+    /* far quads (depth 0.9), the left one pulls its depth to 0.1 in the fragment shader */
+    fb.clear();
+    program.uniforms() = { 1.0f, 0.8f, blue, false };
+    rasterizer.draw(program, quad, fb);
+    program.uniforms() = { x_max, 0.8f, red, true };
+    rasterizer.draw(program, quad, fb);
+
+    program.uniforms() = { 1.0f, 0.0f, green, false };
+    rasterizer.draw(program, quad, fb);
+    passed &= check_color(fb, x_split, "fragment shader depth write");
+
+    /* same with the depth written through the framebuffer */
+    fb.clear();
+    program.uniforms() = { 1.0f, 0.8f, blue, false };
+    rasterizer.draw(program, quad, fb);
+    auto& depth = fb.depth();
+    for(int y = 0; y < size; y++)
+    {
+        for(int x = 0; x < x_split; x++)
+        {
+            depth(x, y) = 0.1f;
+            fb.target<0>()(x, y) = red;
+        }
+    }
+
+    program.uniforms() = { 1.0f, 0.0f, green, false };
+    rasterizer.draw(program, quad, fb);
+    passed &= check_color(fb, x_split, "framebuffer depth write");
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
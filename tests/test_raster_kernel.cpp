@@ -0,0 +1,80 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include <detail/raster_kernel.h>
+
+/* the SIMD kernels have to agree with the scalar kernel on the early depth test, also for NaN depths */
+
+struct DepthTest
+{
+    const char* name;
+    float z_0;
+    float dz;
+    float depth[8];
+    unsigned int mask;
+    bool test;
+};
+
+struct DepthResult
+{
+    unsigned int passed;
+    float depth[8];
+    float z_min;
+};
+
+template<typename Kernel>
+static DepthResult depth_test(const DepthTest& t)
+{
+    DepthResult result;
+    std::memcpy(result.depth, t.depth, sizeof(result.depth));
+    result.z_min = std::numeric_limits<float>::max();
+    result.passed = Kernel::depth_test(t.z_0, t.dz, result.depth, t.mask, 0xFF, t.test, result.z_min);
+    return result;
+}
+
+static bool same_result(const DepthTest& t, const char* kernel, const DepthResult& a, const DepthResult& b)
+{
+    /* bitwise, NaN written to the depth buffer has to be NaN in both */
+    if(a.passed != b.passed || std::memcmp(a.depth, b.depth, sizeof(a.depth)) != 0 || std::memcmp(&a.z_min, &b.z_min, sizeof(float)) != 0)
+    {
+        std::printf("%s: %s differs from the scalar kernel (passed 0x%02x, 0x%02x; z_min %g, %g)\n", t.name, kernel, a.passed, b.passed, a.z_min, b.z_min);
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+
+    const DepthTest tests[] =
+    {
+        { "nan depth lanes", 0.5f, 0.01f, { nan, 0.9f, nan, 0.1f, 0.5f, nan, 0.2f, 0.9f }, 0xFF, true },
+        { "nan depth lanes outside of mask", 0.5f, 0.01f, { nan, 0.9f, nan, 0.1f, 0.5f, nan, 0.2f, 0.9f }, 0x5A, true },
+        { "nan fragment depth", nan, 0.01f, { 0.3f, 0.9f, nan, 0.1f, 0.5f, 0.7f, 0.2f, 0.9f }, 0xFF, true },
+        { "nan fragment depth from the plane", inf, -inf, { 0.3f, 0.9f, nan, 0.1f, 0.5f, 0.7f, 0.2f, 0.9f }, 0xFF, true },
+        { "nan depth lanes without test", 0.5f, 0.01f, { nan, 0.9f, nan, 0.1f, 0.5f, nan, 0.2f, 0.9f }, 0xFF, false },
+        { "equal depth", 0.5f, 0.0f, { 0.5f, 0.5f, 0.4f, 0.6f, 0.5f, 0.5f, 0.5f, 0.5f }, 0xFF, true },
+    };
+
+    bool passed = true;
+    for(const DepthTest& t : tests)
+    {
+        DepthResult scalar = depth_test<detail::RasterKernelScalar>(t);
+
+#if defined(__SSE2__) || defined(_M_X64)
+        passed &= same_result(t, "SSE2", scalar, depth_test<detail::RasterKernelSSE2>(t));
+#endif
+
+#if defined(__AVX2__)
+        passed &= same_result(t, "AVX2", scalar, depth_test<detail::RasterKernelAVX2>(t));
+#endif
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+
+#include <renderer.h>
+#include <sampler.h>
+#include <math/matrix4.h>
+
+/* texture(sampler, uv) of a varying selects the mip level of texture(sampler, in, uv) */
+
+struct Vertex
+{
+    Vec3 pos;
+    Vec2 uv;
+};
+
+struct Varying
+{
+    Vec4 position;
+    Vec2 uv;
+
+    VARYING(position, uv);
+};
+
+struct Uniforms
+{
+    Mat4 mvp;
+    Sampler<RGBA8> texture;
+};
+
+/* number of pixels in which the framebuffers a and b differ by more than rounding (derivatives may be contracted differently with -ffast-math) */
+static int count_differences(Renderer& a, Renderer& b)
+{
+    int differences = 0;
+    for(int y = 0; y < a.framebuffer().color().height(); y++)
+    {
+        for(int x = 0; x < a.framebuffer().color().width(); x++)
+        {
+            Vec4 d = abs(Vec4(a.framebuffer().color()(x, y)) - Vec4(b.framebuffer().color()(x, y)));
+            if(std::max({ d.x, d.y, d.z, d.w }) > 1.0f) differences++;
+        }
+    }
+
+    return differences;
+}
+
+int main(int argc, char** argv)
+{
+    auto vertex_shader = [](const Uniforms& uniform, const Vertex& in, Varying& out)
+    {
+        out.position = uniform.mvp * Vec4(in.pos, 1.0f);
+        out.uv = in.uv;
+    };
+
+    auto program_precise = make_program<Vertex, Varying, Uniforms>(vertex_shader, [](const Uniforms& uniform, const Varying& in, Vec4& out)
+    {
+        out = Vec4(texture(uniform.texture, in, &Varying::uv)) / 255.0f;
+    });
+
+    auto program_uv = make_program<Vertex, Varying, Uniforms>(vertex_shader, [](const Uniforms& uniform, const Varying& in, Vec4& out)
+    {
+        out = Vec4(texture(uniform.texture, in.uv)) / 255.0f;
+    });
+
+    auto program_base = make_program<Vertex, Varying, Uniforms>(vertex_shader, [](const Uniforms& uniform, const Varying& in, Vec4& out)
+    {
+        out = Vec4(textureLod(uniform.texture, in.uv, 0.0f)) / 255.0f;
+    });
+
+    /* checkerboard with mip maps on a plane towards the horizon */
+    Texture<RGBA8> checker(256, 256);
+    for(int y = 0; y < checker.height(); y++)
+    {
+        for(int x = 0; x < checker.width(); x++) checker(x, y) = RGBA8(((x / 4 + y / 4) & 1) * 255, (x * 7 + y * 3) & 255, 0, 255);
+    }
+    checker.generate_mipmaps();
+
+    const int width = 320;
+    const int height = 200;
+    for(Uniforms* uniforms : { &program_precise.uniforms(), &program_uv.uniforms(), &program_base.uniforms() })
+    {
+        uniforms->mvp = Mat4::perspective(0.8f, float(width) / height, 0.1f, 10.0f) * Mat4::translation(Vec3(0.0f, -0.5f, -2.0f)) * Mat4::rotationY(0.4f);
+        uniforms->texture = checker;
+        uniforms->texture.filter = eFilter::LINEAR_MIPMAP_LINEAR;
+        uniforms->texture.wrap = eWrap::REPEAT;
+    }
+
+    BufferIndexed<Vertex, unsigned int> plane;
+    plane.vertices = { { {-1, 0, -1}, {0, 0} }, { {1, 0, -1}, {1, 0} }, { {1, 0, 1}, {1, 1} }, { {-1, 0, 1}, {0, 1} } };
+    plane.indices = { 0, 2, 1, 0, 3, 2 };
+
+    Renderer precise(width, height);
+    Renderer uv(width, height);
+    Renderer base(width, height);
+
+    precise.framebuffer().clear();
+    uv.framebuffer().clear();
+    base.framebuffer().clear();
+
+    precise.draw(program_precise, plane);
+    uv.draw(program_uv, plane);
+    base.draw(program_base, plane);
+
+    bool passed = true;
+    if(int differences = count_differences(precise, uv))
+    {
+        std::printf("texture(sampler, in.uv) differs from texture(sampler, in, &Varying::uv) in %d pixels\n", differences);
+        passed = false;
+    }
+
+    if(!count_differences(precise, base))
+    {
+        std::printf("texture(sampler, in, &Varying::uv) samples the base level only\n");
+        passed = false;
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}